@@ -0,0 +1,98 @@
+// gen.c - synthetic workload generator for the benchmark suite
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// func dec
+void genGlobals(int n);
+void genFunctions(int n);
+void genCalls(int n);
+void genExpr(int n);
+void genLoops(int n);
+void genComments(int n);
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: gen <globals|functions|calls|expr|loops|comments> <size> [seed]\n");
+        return 1;
+    } int n = atoi(argv[2]);
+    srand(argc > 3 ? atoi(argv[3]) : 1);
+    if (strcmp(argv[1], "globals") == 0) genGlobals(n);
+    else if (strcmp(argv[1], "functions") == 0) genFunctions(n);
+    else if (strcmp(argv[1], "calls") == 0) genCalls(n);
+    else if (strcmp(argv[1], "expr") == 0) genExpr(n);
+    else if (strcmp(argv[1], "loops") == 0) genLoops(n);
+    else if (strcmp(argv[1], "comments") == 0) genComments(n);
+    else {
+        fprintf(stderr, "unknown shape %s\n", argv[1]);
+        return 1;
+    } return 0;
+}
+
+// n globals, each initialised from earlier ones
+void genGlobals(int n) {
+    printf("int g0 = 1;\n");
+    for (int i = 1; i < n; i++) {
+        printf("int g%d = g%d + %d;\n", i, rand() % i, rand() % 100);
+    } printf("int main()\n{\n    g0 = g%d;\n}\n", n - 1);
+}
+
+// n small functions with params and locals, all called from main
+void genFunctions(int n) {
+    printf("int total = 0;\n");
+    for (int i = 0; i < n; i++) {
+        printf("int f%d(int a, int b)\n{\n    int t = a * %d + b;\n    total += t;\n    return t;\n}\n",
+            i, rand() % 10 + 1);
+    } printf("int main()\n{\n");
+    for (int i = 0; i < n; i++) printf("    f%d(%d, %d);\n", i, i, rand() % 50);
+    printf("}\n");
+}
+
+// a call chain n deep: main -> c0 -> c1 -> ... -> c(n-1)
+void genCalls(int n) {
+    printf("int depth = 0;\n");
+    printf("int c%d(int x)\n{\n    depth += 1;\n    return x;\n}\n", n - 1);
+    for (int i = n - 2; i >= 0; i--) {
+        printf("int c%d(int x)\n{\n    depth += 1;\n    return c%d(x + 1);\n}\n", i, i + 1);
+    } printf("int main()\n{\n    depth = c0(0);\n}\n");
+}
+
+// n statements with long operator-dense expressions
+void genExpr(int n) {
+    const char* ops[] = { "+", "-", "*", "<", ">=", "==", "&&", "||" };
+    printf("int a = 7;\nint b = 3;\nint r = 0;\nint main()\n{\n");
+    for (int i = 0; i < n; i++) {
+        printf("    r = ");
+        for (int k = 0; k < 12; k++) {
+            printf("(a %s %d) %s ", ops[rand() % 8], rand() % 9 + 1, ops[rand() % 3]);
+        } printf("(b / %d) %% %d;\n", rand() % 9 + 1, rand() % 9 + 1);
+    } printf("}\n");
+}
+
+// n loops and branches with small bodies
+void genLoops(int n) {
+    printf("int i = 0;\nint sum = 0;\nint main()\n{\n");
+    for (int k = 0; k < n; k++) {
+        switch (k % 3) {
+        case 0:
+            printf("    for (i; i < %d; i++)\n    {\n        sum += i;\n    }\n", rand() % 100);
+            break;
+        case 1:
+            printf("    while (sum < %d)\n    {\n        sum = sum + 3;\n    }\n", rand() % 1000);
+            break;
+        default:
+            printf("    if (sum > %d)\n    {\n        sum -= 1;\n    }\n    else\n    {\n        sum += 2;\n    }\n",
+                rand() % 1000);
+            break;
+        }
+    } printf("}\n");
+}
+
+// n declarations buried in comments and char literals
+void genComments(int n) {
+    for (int i = 0; i < n; i++) {
+        printf("// line comment %d: the quick brown fox jumps over the lazy dog\n", i);
+        printf("/* block comment %d\n * spanning several lines, with = + - ; { } ( ) inside\n */\n", i);
+        printf("char c%d = '%c'; /* trailing */ // and more\n", i, 'a' + rand() % 26);
+    } printf("int main()\n{\n    c0 = 'z';\n}\n");
+}
@@ -0,0 +1,73 @@
+// relex_check.c - compare relexBuffer() against a full lex over random edits
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../lexer.h"
+
+extern Token* tokens;
+extern int numTokens;
+
+// func dec
+int checkEdit(char* before, char* after);
+char* writeTemp(char* text);
+
+char* base = "// hdr\nint apple = 1; /* c */\nint f(int a) {\n  return a + 2; // x\n}\n"
+    "int main() { apple += f(3); 'c' ; apple >= 4.5; }\n";
+
+int main(int argc, char* argv[]) {
+    int iterations = argc > 1 ? atoi(argv[1]) : 20000;
+    int bad = 0;
+    // edits before the first token
+    bad += !checkEdit("// hdr\nint a = 1;\nint main()\n{\n  a = 5;\n}\n",
+        "// header comment\nint a = 1;\nint main()\n{\n  a = 5;\n}\n");
+    bad += !checkEdit("\n\nint a = 1;\n", "int a = 1;\n");
+    bad += !checkEdit("int a = 1;\n", "  /* x */ int a = 1;\n");
+    const char* inserts[] = { "", "x", "/*", "*/", "\"", "\n", " ", "=", "+", "12", "//", "'a'" };
+    srand(1);
+    int len = strlen(base);
+    char* after = malloc(len + 16);
+    for (int i = 0; i < iterations; i++) {
+        int pos = rand() % (len + 1);
+        int cut = rand() % 4;
+        if (pos + cut > len) cut = len - pos;
+        memcpy(after, base, pos);
+        strcpy(after + pos, inserts[rand() % 12]);
+        strcat(after, base + pos + cut);
+        bad += !checkEdit(base, after);
+    } free(after);
+    printf("%d mismatches\n", bad);
+    return bad != 0;
+}
+
+// 1 if re-lexing before -> after gives the same tokens as lexing after from scratch
+int checkEdit(char* before, char* after) {
+    char* path = writeTemp(before);
+    openFile(path);
+    bufferTokens();
+    char* text = strdup(after);
+    relexBuffer(text, strlen(text));
+    int count = numTokens;
+    Token* incremental = malloc(count * sizeof(Token));
+    memcpy(incremental, tokens, count * sizeof(Token));
+    closeFile();
+    path = writeTemp(after);
+    openFile(path);
+    bufferTokens();
+    int same = count == numTokens;
+    for (int i = 0; same && i < count; i++) {
+        same = incremental[i].type == tokens[i].type && incremental[i].line == tokens[i].line &&
+            incremental[i].start == tokens[i].start && incremental[i].end == tokens[i].end &&
+            strcmp(incremental[i].lexeme, tokens[i].lexeme) == 0;
+    } closeFile();
+    free(incremental);
+    if (!same) printf("mismatch: \"%s\" -> \"%s\"\n", before, after);
+    return same;
+}
+
+char* writeTemp(char* text) {
+    static char path[] = "/tmp/relex_check.txt";
+    FILE* file = fopen(path, "w");
+    fputs(text, file);
+    fclose(file);
+    return path;
+}
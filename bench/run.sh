@@ -0,0 +1,40 @@
+#!/bin/sh
+# run.sh - build the parser and generator, run every workload shape, save and compare results
+# usage: bench/run.sh [size] [results file]
+# PARSER_FLAGS is passed to every parser run, e.g. PARSER_FLAGS=--max-statements=1000000000
+set -e
+cd "$(dirname "$0")/.."
+size=${1:-5000}
+mkdir -p bench/results
+out=${2:-bench/results/$(date +%Y%m%d-%H%M%S).tsv}
+prev=$(ls bench/results/*.tsv 2>/dev/null | grep -v "^$out\$" | tail -n 1 || true)
+
+cc -O2 -pthread -o bench/parser parser.c lexer.c stats.c profile.c budget.c output.c check.c -lm
+cc -O2 -o bench/gen bench/gen.c
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+printf "shape\tsize\tbytes\tlex_bytes_per_s\ttokens_per_s\tstatements_per_s\tpeak_rss_kb\n" > "$out"
+for shape in globals functions calls expr loops comments; do
+    bench/gen $shape "$size" > "$work/$shape.txt"
+    bench/parser $PARSER_FLAGS --stats=json "$work/$shape.txt" | tail -n 1 | awk -v shape=$shape -v size="$size" '
+        function field(name,   m) {
+            if (match($0, "\"" name "\":[0-9.]+")) return substr($0, RSTART + length(name) + 3, RLENGTH - length(name) - 3)
+            return 0
+        } {
+            lex = field("lex_ms") / 1000; parse = field("parse_ms") / 1000
+            if (lex <= 0) lex = 1e-9; if (parse <= 0) parse = 1e-9
+            printf "%s\t%d\t%d\t%.0f\t%.0f\t%.0f\t%d\n", shape, size, field("chars"),
+                field("chars") / lex, field("tokens") / (lex + parse), field("statements") / parse, field("peak_rss_kb")
+        }' >> "$out"
+done
+
+cat "$out"
+echo "saved $out"
+# throughput change per shape against the previous run
+if [ -n "$prev" ]; then
+    echo "compared with $prev:"
+    awk -F '\t' 'FNR == 1 { next } NR == FNR { lex[$1] = $4; tok[$1] = $5; st[$1] = $6; rss[$1] = $7; next }
+        ($1 in lex) { printf "%-10s lex %+6.1f%%  tokens %+6.1f%%  statements %+6.1f%%  rss %+6.1f%%\n", $1,
+            100 * ($4 / lex[$1] - 1), 100 * ($5 / tok[$1] - 1), 100 * ($6 / st[$1] - 1), 100 * ($7 / rss[$1] - 1) }' "$prev" "$out"
+fi
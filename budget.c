@@ -0,0 +1,44 @@
+// budget.c
+#include <stdio.h>
+#include "budget.h"
+#include "stats.h"
+
+Budget budget;
+_Thread_local long budgetStatements = 0;
+_Thread_local long budgetBytes = 0;
+_Thread_local int budgetDepth = 0;
+_Thread_local jmp_buf budgetAbort;
+_Thread_local char* budgetReason = NULL;
+
+void resetBudget() {
+    budgetStatements = 0;
+    budgetBytes = 0;
+    budgetDepth = 0;
+    budgetReason = NULL;
+}
+
+void budgetFail(char* reason) {
+    budgetReason = reason;
+    longjmp(budgetAbort, 1);
+}
+
+// called at loop back-edges, calls and top-level statements only
+void budgetCheck() {
+    if (budget.maxStatements && budgetStatements > budget.maxStatements) budgetFail("statement limit exceeded");
+    if (budget.maxBytes && budgetBytes > budget.maxBytes) budgetFail("memory limit exceeded");
+}
+
+void budgetEnter() {
+    budgetDepth++;
+    if (budget.maxDepth && budgetDepth > budget.maxDepth) budgetFail("call depth limit exceeded");
+    budgetCheck();
+}
+
+void budgetLeave() {
+    budgetDepth--;
+}
+
+void chargeAlloc(size_t size) {
+    STAT_ALLOC(size);
+    budgetBytes += (long)size;
+}
@@ -0,0 +1,26 @@
+#ifndef BUDGET_H
+#define BUDGET_H
+
+#include <setjmp.h>
+#include <stddef.h>
+
+// per-session execution limits, 0 = unlimited
+typedef struct {
+    long maxStatements;
+    int maxDepth;
+    long maxBytes;
+} Budget;
+
+extern Budget budget;
+extern _Thread_local long budgetStatements; // bumped per statement, checked in budgetCheck()
+extern _Thread_local jmp_buf budgetAbort;   // longjmp target when a limit is hit
+extern _Thread_local char* budgetReason;
+
+// func dec
+void resetBudget();
+void budgetCheck();
+void budgetEnter();
+void budgetLeave();
+void chargeAlloc(size_t size);
+
+#endif
@@ -0,0 +1,502 @@
+// check.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "lexer.h"
+#include "parser.h"
+#include "check.h"
+#include "stats.h"
+
+#define CHECK_BATCH 32
+
+// a global or a function signature, names point into the token buffer
+typedef struct {
+    char* name;
+    char* type;
+    int params; // functions only
+    int prev;   // older entry in the same bucket, -1 = end
+} CheckName;
+
+// append-only, a prefix of the list is what a given point in the program can see
+typedef struct {
+    CheckName* list;
+    int count;
+    int cap;
+    int* buckets;
+    unsigned size; // power of two
+} NameTable;
+
+typedef struct {
+    int pos;  // token the runtime would report at
+    int seq;  // order within one checker
+    int unit;
+    char* msg;
+} Diag;
+
+// one function body, checked in phase two
+typedef struct {
+    int func;    // index in checkFuncs, the body sees functions 0..func
+    int globals; // globals declared before the definition
+    int params;  // first token of the parameter list
+    int body;    // '{'
+} CheckUnit;
+
+typedef struct {
+    char* name;
+    char* type;
+} CheckLocal;
+
+// cursor and results for the top level or one body
+typedef struct {
+    int unit;    // -1 = top level
+    int pos;
+    int globals; // visible prefixes of checkGlobals and checkFuncs
+    int funcs;
+    CheckLocal* locals; // params first, then locals in declaration order
+    int numLocals;
+    int capLocals;
+    Diag* diags;
+    int numDiags;
+    int capDiags;
+    int stopPos; // where checking gave up on the syntax, -1 = never
+    char* stopMsg; // the runtime's message there, NULL if it fails silently
+} Checker;
+
+int checkThreads = 4;
+NameTable checkGlobals;
+NameTable checkFuncs;
+CheckUnit* checkUnits = NULL;
+int numCheckUnits = 0;
+
+// func dec
+int checkStatement(Checker* c);
+int checkExpression(Checker* c);
+int checkBlock(Checker* c);
+
+void nameInit(NameTable* table, unsigned size) {
+    memset(table, 0, sizeof(NameTable));
+    table->size = size;
+    table->buckets = malloc(size * sizeof(int));
+    memset(table->buckets, -1, size * sizeof(int));
+}
+
+int nameAdd(NameTable* table, char* name, char* type, int params) {
+    if (table->count == table->cap) {
+        table->cap = table->cap ? table->cap * 2 : 64;
+        table->list = realloc(table->list, table->cap * sizeof(CheckName));
+    } unsigned h = hashName(name) & (table->size - 1);
+    CheckName* entry = &table->list[table->count];
+    entry->name = name;
+    entry->type = type;
+    entry->params = params;
+    entry->prev = table->buckets[h];
+    table->buckets[h] = table->count;
+    return table->count++;
+}
+
+// newest entry among the first limit, -1 if the name is not visible there
+int nameFind(NameTable* table, char* name, int limit) {
+    int i = table->buckets[hashName(name) & (table->size - 1)];
+    while (i >= 0) {
+        if (i < limit && strcmp(table->list[i].name, name) == 0) return i;
+        i = table->list[i].prev;
+    } return -1;
+}
+
+void nameFree(NameTable* table) {
+    free(table->list);
+    free(table->buckets);
+    memset(table, 0, sizeof(NameTable));
+}
+
+Token* checkTok(Checker* c) {
+    return tokenAt(c->pos);
+}
+
+int checkOp(Checker* c, OperatorType op) {
+    Token* tok = tokenAt(c->pos);
+    return tok->type == TYPE_OPERATOR && tok->op == op;
+}
+
+void checkError(Checker* c, char* msg) {
+    if (c->numDiags == c->capDiags) {
+        c->capDiags = c->capDiags ? c->capDiags * 2 : 8;
+        c->diags = realloc(c->diags, c->capDiags * sizeof(Diag));
+    } Diag* diag = &c->diags[c->numDiags];
+    diag->pos = c->pos;
+    diag->seq = c->numDiags++;
+    diag->unit = c->unit;
+    diag->msg = msg;
+}
+
+// a syntax error ends this checker, execution reports it the same way
+int checkStop(Checker* c, char* msg) {
+    c->stopPos = c->pos;
+    c->stopMsg = msg;
+    return 0;
+}
+
+void checkAddLocal(Checker* c, char* name, char* type) {
+    if (c->numLocals == c->capLocals) {
+        c->capLocals = c->capLocals ? c->capLocals * 2 : 16;
+        c->locals = realloc(c->locals, c->capLocals * sizeof(CheckLocal));
+    } c->locals[c->numLocals].name = name;
+    c->locals[c->numLocals++].type = type;
+}
+
+// same order as findSymbol(): locals newest first, params, globals
+char* checkFindSymbol(Checker* c, char* name) {
+    for (int i = c->numLocals - 1; i >= 0; i--) {
+        if (strcmp(c->locals[i].name, name) == 0) return c->locals[i].type;
+    } int g = nameFind(&checkGlobals, name, c->globals);
+    return g < 0 ? NULL : checkGlobals.list[g].type;
+}
+
+int isValueType(char* type) {
+    return strcmp(type, "int") == 0 || strcmp(type, "float") == 0 || strcmp(type, "char") == 0;
+}
+
+// mirrors funcCall(), cursor on '('
+int checkCall(Checker* c, char* name) {
+    int func = nameFind(&checkFuncs, name, c->funcs);
+    if (func < 0) checkError(c, "Undefined function");
+    c->pos++;
+    int count = 0;
+    while (!checkOp(c, OP_RPAREN)) {
+        if (checkTok(c)->type == TYPE_EOF) return checkStop(c, "Expected ')' in function call");
+        if (!checkExpression(c)) return 0;
+        count++;
+        if (checkOp(c, OP_COMMA)) c->pos++;
+        else if (!checkOp(c, OP_RPAREN)) return checkStop(c, "Expected ')' in function call");
+    } c->pos++;
+    if (func >= 0 && count != checkFuncs.list[func].params) checkError(c, "Argument count mismatch");
+    return 1;
+}
+
+int checkPrimary(Checker* c) {
+    Token* tok = checkTok(c);
+    if (tok->type == TYPE_INTEGER || tok->type == TYPE_FLOAT || tok->type == TYPE_CHAR) {
+        c->pos++;
+    } else if (tok->type == TYPE_IDENTIFIER) {
+        c->pos++;
+        if (checkOp(c, OP_LPAREN)) {
+            if (!checkCall(c, tok->lexeme)) return 0;
+        } else if (checkFindSymbol(c, tok->lexeme) == NULL) checkError(c, "Variable not declared");
+    } else if (checkOp(c, OP_LPAREN)) {
+        c->pos++;
+        if (checkTok(c)->type == TYPE_EOF) return checkStop(c, "Unexpected EOF after '('");
+        if (!checkExpression(c)) return 0;
+        if (!checkOp(c, OP_RPAREN)) return checkStop(c, "Expected ')'");
+        c->pos++;
+    } else {
+        return 1; // primary() consumes nothing here
+    } if (checkOp(c, OP_INC) || checkOp(c, OP_DEC)) c->pos++;
+    return 1;
+}
+
+int checkUnary(Checker* c) {
+    while (checkOp(c, OP_NOT) || checkOp(c, OP_MINUS) || checkOp(c, OP_INC) || checkOp(c, OP_DEC)) c->pos++;
+    return checkPrimary(c);
+}
+
+int isBinaryOp(Token* tok) {
+    if (tok->type != TYPE_OPERATOR) return 0;
+    switch (tok->op) {
+    case OP_OR: case OP_AND: case OP_EQ: case OP_NE:
+    case OP_LT: case OP_GT: case OP_LE: case OP_GE:
+    case OP_PLUS: case OP_MINUS: case OP_STAR: case OP_SLASH: case OP_PERCENT:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+// every precedence level is a left-assoc loop over the same operand, so one loop consumes the same tokens
+int checkExpression(Checker* c) {
+    if (checkOp(c, OP_SEMI)) return 1;
+    if (!checkUnary(c)) return 0;
+    while (isBinaryOp(checkTok(c))) {
+        c->pos++;
+        if (!checkUnary(c)) return 0;
+    } return 1;
+}
+
+// mirrors skipFunction(), cursor on '('
+int checkSkipFunction(Checker* c) {
+    while (!checkOp(c, OP_RPAREN)) {
+        if (checkTok(c)->type == TYPE_EOF) return checkStop(c, "Expected ')'");
+        c->pos++;
+    } c->pos++;
+    if (!checkOp(c, OP_LBRACE)) return checkStop(c, NULL);
+    int depth = 0;
+    do {
+        if (checkTok(c)->type == TYPE_EOF) return checkStop(c, "Unexpected EOF in block");
+        if (checkOp(c, OP_LBRACE)) depth++;
+        else if (checkOp(c, OP_RBRACE)) depth--;
+        c->pos++;
+    } while (depth > 0);
+    return 1;
+}
+
+// phase one: record the signature and the body as a unit, then step over the body
+int checkDefinition(Checker* c, char* type, char* name) {
+    if (!isReachable(name)) return checkSkipFunction(c);
+    c->pos++;
+    int first = c->pos, params = 0;
+    while (!checkOp(c, OP_RPAREN)) {
+        if (checkTok(c)->type != TYPE_TYPE) break;
+        c->pos++;
+        if (checkTok(c)->type != TYPE_IDENTIFIER) return checkStop(c, "Expected parameter name");
+        c->pos++;
+        params++;
+        if (checkOp(c, OP_COMMA)) c->pos++;
+    } if (!checkOp(c, OP_RPAREN)) return checkStop(c, "Expected ')'");
+    c->pos++;
+    int func = nameAdd(&checkFuncs, name, type, params);
+    c->funcs = checkFuncs.count;
+    if (!checkOp(c, OP_LBRACE)) return checkStop(c, NULL);
+    checkUnits = realloc(checkUnits, (numCheckUnits + 1) * sizeof(CheckUnit));
+    CheckUnit* unit = &checkUnits[numCheckUnits++];
+    unit->func = func;
+    unit->globals = checkGlobals.count;
+    unit->params = first;
+    unit->body = c->pos;
+    int depth = 0;
+    do {
+        if (checkTok(c)->type == TYPE_EOF) return 1; // the body's checker reports it
+        if (checkOp(c, OP_LBRACE)) depth++;
+        else if (checkOp(c, OP_RBRACE)) depth--;
+        c->pos++;
+    } while (depth > 0);
+    return 1;
+}
+
+int checkDeclaration(Checker* c) {
+    char* type = checkTok(c)->lexeme;
+    c->pos++;
+    if (checkTok(c)->type != TYPE_IDENTIFIER) return checkStop(c, "Expected variable name");
+    char* name = checkTok(c)->lexeme;
+    c->pos++;
+    if (checkOp(c, OP_LPAREN)) {
+        if (c->unit >= 0) return checkStop(c, NULL); // definition inside a body, left to execution
+        return checkDefinition(c, type, name);
+    } if (checkOp(c, OP_ASSIGN)) {
+        c->pos++;
+        if (!checkExpression(c)) return 0;
+    } if (!checkOp(c, OP_SEMI)) return checkStop(c, "Expected ';'");
+    c->pos++;
+    if (c->unit >= 0) checkAddLocal(c, name, type);
+    else {
+        nameAdd(&checkGlobals, name, type, 0);
+        c->globals = checkGlobals.count;
+    } return 1;
+}
+
+int checkAssignment(Checker* c, char* name) {
+    Token* op = checkTok(c);
+    if (op->type != TYPE_OPERATOR || (op->op != OP_ASSIGN && op->op != OP_ADD_ASSIGN &&
+        op->op != OP_SUB_ASSIGN && op->op != OP_MUL_ASSIGN && op->op != OP_DIV_ASSIGN &&
+        op->op != OP_MOD_ASSIGN)) return checkStop(c, "Expected assignment operator");
+    c->pos++;
+    if (!checkExpression(c)) return 0;
+    char* type = checkFindSymbol(c, name);
+    if (type == NULL) checkError(c, "Variable not declared");
+    else if (!isValueType(type) || (op->op == OP_MOD_ASSIGN && strcmp(type, "int") != 0)) {
+        checkError(c, "Invalid assignment type");
+    } if (!checkOp(c, OP_SEMI)) return checkStop(c, "Expected ';'");
+    c->pos++;
+    return 1;
+}
+
+int checkIf(Checker* c) {
+    c->pos++;
+    if (!checkOp(c, OP_LPAREN)) return checkStop(c, "Expected '(' after if");
+    c->pos++;
+    if (!checkExpression(c)) return 0;
+    if (!checkOp(c, OP_RPAREN)) return checkStop(c, "Expected ')' after if condition");
+    c->pos++;
+    if (!checkStatement(c)) return 0;
+    Token* tok = checkTok(c);
+    if (tok->type == TYPE_RESERVED && strcmp(tok->lexeme, "else") == 0) {
+        c->pos++;
+        if (!checkStatement(c)) return 0;
+    } return 1;
+}
+
+int checkWhile(Checker* c) {
+    c->pos++;
+    if (!checkOp(c, OP_LPAREN)) return checkStop(c, "Expected '(' after while");
+    c->pos++;
+    if (!checkExpression(c)) return 0;
+    if (!checkOp(c, OP_RPAREN)) return checkStop(c, "Expected ')' after while condition");
+    c->pos++;
+    return checkStatement(c);
+}
+
+int checkFor(Checker* c) {
+    c->pos++;
+    if (!checkOp(c, OP_LPAREN)) return checkStop(c, "Expected '(' after for");
+    c->pos++;
+    if (checkTok(c)->type == TYPE_TYPE) {
+        if (!checkStatement(c)) return 0;
+    } else if (checkTok(c)->type == TYPE_IDENTIFIER) {
+        if (!checkExpression(c)) return 0;
+        if (!checkOp(c, OP_SEMI)) return checkStop(c, "Expected ';' after initialization");
+        c->pos++;
+    } else if (checkOp(c, OP_SEMI)) {
+        c->pos++;
+    } else return checkStop(c, "Invalid for loop initialization");
+    if (!checkExpression(c)) return 0;
+    if (!checkOp(c, OP_SEMI)) return checkStop(c, "Expected ';' after for condition");
+    c->pos++;
+    if (!checkOp(c, OP_RPAREN) && !checkExpression(c)) return 0;
+    if (!checkOp(c, OP_RPAREN)) return checkStop(c, "Expected ')' in for loop");
+    c->pos++;
+    return checkStatement(c);
+}
+
+int checkReturn(Checker* c) {
+    c->pos++;
+    if (!checkExpression(c)) return 0;
+    if (!checkOp(c, OP_SEMI)) return checkStop(c, "Expected ';' after return");
+    c->pos++;
+    return 1;
+}
+
+// mirrors statement(); bodies run once, top to bottom, so a linear walk sees what execution sees
+int checkStatement(Checker* c) {
+    Token* tok = checkTok(c);
+    if (tok->type == TYPE_TYPE) return checkDeclaration(c);
+    if (tok->type == TYPE_IDENTIFIER) {
+        c->pos++;
+        if (!checkOp(c, OP_LPAREN)) return checkAssignment(c, tok->lexeme);
+        if (!checkCall(c, tok->lexeme)) return 0;
+        if (checkOp(c, OP_SEMI)) c->pos++;
+        return 1;
+    } if (tok->type == TYPE_RESERVED) {
+        if (strcmp(tok->lexeme, "if") == 0) return checkIf(c);
+        if (strcmp(tok->lexeme, "while") == 0) return checkWhile(c);
+        if (strcmp(tok->lexeme, "for") == 0) return checkFor(c);
+        if (strcmp(tok->lexeme, "return") == 0) return checkReturn(c);
+        return checkStop(c, NULL);
+    } if (checkOp(c, OP_LBRACE)) return checkBlock(c);
+    if (checkOp(c, OP_SEMI)) {
+        c->pos++;
+        return 1;
+    } return checkStop(c, "Expected declaration, assignment, or statement");
+}
+
+int checkBlock(Checker* c) {
+    if (!checkOp(c, OP_LBRACE)) return checkStop(c, NULL);
+    c->pos++;
+    while (!checkOp(c, OP_RBRACE)) {
+        if (checkTok(c)->type == TYPE_EOF) return checkStop(c, "Unexpected EOF in block");
+        if (!checkStatement(c)) return 0;
+    } c->pos++;
+    return 1;
+}
+
+// phase two for one unit: params become the first locals, then the body is walked
+void checkUnit(Checker* c, int unit) {
+    memset(c, 0, sizeof(Checker));
+    c->unit = unit;
+    c->stopPos = -1;
+    c->globals = checkUnits[unit].globals;
+    c->funcs = checkUnits[unit].func + 1; // a body can call itself
+    for (c->pos = checkUnits[unit].params; checkTok(c)->type == TYPE_TYPE; ) {
+        char* type = checkTok(c)->lexeme;
+        c->pos++;
+        checkAddLocal(c, checkTok(c)->lexeme, type);
+        c->pos++;
+        if (checkOp(c, OP_COMMA)) c->pos++;
+    } c->pos = checkUnits[unit].body;
+    checkBlock(c);
+}
+
+typedef struct {
+    Checker* checkers;
+    int next;
+    pthread_mutex_t lock;
+} CheckQueue;
+
+// bodies are small, so workers claim them in batches to keep the lock cold
+void* checkWorker(void* arg) {
+    CheckQueue* queue = arg;
+    while (1) {
+        pthread_mutex_lock(&queue->lock);
+        int first = queue->next;
+        queue->next += CHECK_BATCH;
+        pthread_mutex_unlock(&queue->lock);
+        if (first >= numCheckUnits) return NULL;
+        for (int i = first; i < first + CHECK_BATCH && i < numCheckUnits; i++) checkUnit(&queue->checkers[i], i);
+    }
+}
+
+int compareDiags(const void* a, const void* b) {
+    const Diag* x = a;
+    const Diag* y = b;
+    if (x->pos != y->pos) return x->pos < y->pos ? -1 : 1;
+    if (x->unit != y->unit) return x->unit < y->unit ? -1 : 1;
+    return x->seq - y->seq;
+}
+
+// 1 = nothing to report before the first syntax error, execution takes over from there
+int checkProgram() {
+    double start = nowMs();
+    unsigned size = 64;
+    while (size < (unsigned)tokenCount() / 2) size *= 2;
+    nameInit(&checkGlobals, size);
+    nameInit(&checkFuncs, size);
+    // phase one: the top level in source order
+    Checker top;
+    memset(&top, 0, sizeof(Checker));
+    top.unit = -1;
+    top.stopPos = -1;
+    while (checkTok(&top)->type != TYPE_EOF) {
+        if (!checkStatement(&top)) break;
+    } // phase two: bodies are independent once signatures and globals are known
+    Checker* checkers = calloc(numCheckUnits + 1, sizeof(Checker));
+    int batches = (numCheckUnits + CHECK_BATCH - 1) / CHECK_BATCH;
+    int numThreads = checkThreads < batches ? checkThreads : batches;
+    if (numThreads <= 1) {
+        for (int i = 0; i < numCheckUnits; i++) checkUnit(&checkers[i], i);
+    } else {
+        CheckQueue queue = { .checkers = checkers, .next = 0 };
+        pthread_mutex_init(&queue.lock, NULL);
+        pthread_t* threads = malloc(numThreads * sizeof(pthread_t));
+        for (int i = 0; i < numThreads; i++) pthread_create(&threads[i], NULL, checkWorker, &queue);
+        for (int i = 0; i < numThreads; i++) pthread_join(threads[i], NULL);
+        free(threads);
+        pthread_mutex_destroy(&queue.lock);
+    } checkers[numCheckUnits] = top;
+    // execution stops at the first syntax error, so nothing past it is reported
+    Checker* stop = NULL;
+    int numDiags = 0;
+    for (int i = 0; i <= numCheckUnits; i++) {
+        if (checkers[i].stopPos >= 0 && (stop == NULL || checkers[i].stopPos < stop->stopPos)) stop = &checkers[i];
+        numDiags += checkers[i].numDiags;
+    } Diag* diags = malloc((numDiags + 1) * sizeof(Diag));
+    numDiags = 0;
+    for (int i = 0; i <= numCheckUnits; i++) {
+        for (int j = 0; j < checkers[i].numDiags; j++) {
+            Diag* diag = &checkers[i].diags[j];
+            if (stop == NULL || &checkers[i] == stop || diag->pos < stop->stopPos) diags[numDiags++] = *diag;
+        }
+    } qsort(diags, numDiags, sizeof(Diag), compareDiags);
+    for (int i = 0; i < numDiags; i++) diagnostic(diags[i].msg, tokenAt(diags[i].pos)->line);
+    if (numDiags > 0 && stop != NULL && stop->stopMsg != NULL) diagnostic(stop->stopMsg, tokenAt(stop->stopPos)->line);
+    int ok = numDiags == 0;
+    free(diags);
+    for (int i = 0; i <= numCheckUnits; i++) {
+        free(checkers[i].locals);
+        free(checkers[i].diags);
+    } free(checkers);
+    free(checkUnits);
+    checkUnits = NULL;
+    numCheckUnits = 0;
+    nameFree(&checkGlobals);
+    nameFree(&checkFuncs);
+    STAT_ADD(checkMs, nowMs() - start);
+    return ok;
+}
@@ -0,0 +1,12 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+// static front end over the buffered tokens, run before execution
+// phase one walks the top level in order, collecting globals and function signatures
+// phase two checks every function body on a pool of checkThreads threads
+extern int checkThreads;
+
+// func dec
+int checkProgram();
+
+#endif
@@ -4,43 +4,83 @@
 #include <string.h>
 #include <ctype.h>
 #include "lexer.h"
+#include "stats.h"
+#include "budget.h"
+#include "output.h"
 
-// global vars
-char current;
-char lookahead;
-FILE* source_file;
-int line = 1;
-int isEOF = 0;
-Token curr; // global var 
+// global vars, cursor state is per thread so runs can share one token stream
+_Thread_local char current;
+_Thread_local char lookahead;
+char* src = NULL; // whole source file
+int srcLen = 0;
+_Thread_local int srcPos = 0; // index of current
+_Thread_local int line = 1;
+_Thread_local int isEOF = 0;
+_Thread_local Token curr; // global var 
+// buffered token stream, read-only once lexed
+Token* tokens = NULL;
+int numTokens = 0;
+_Thread_local int tokenPos = 0;
+
+char* readSource(char* filename, int* len) {
+	FILE* file = fopen(filename, "rb");
+	if (!file) return NULL;
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	char* text = malloc(size + 1);
+	chargeAlloc(size + 1);
+	*len = (int)fread(text, 1, size, file);
+	text[*len] = '\0';
+	fclose(file);
+	return text;
+}
+
+// position the char cursor at pos
+void seekChar(int pos) {
+	srcPos = pos;
+	isEOF = pos >= srcLen;
+	current = isEOF ? EOF : src[pos];
+	lookahead = pos + 1 < srcLen ? src[pos + 1] : EOF;
+}
 
 void openFile(char* filename) {
-	source_file = fopen(filename, "r");
-	if (!source_file) exit(1);
-	current = fgetc(source_file);
-	if (current == EOF) isEOF = 1; 
-	else lookahead = fgetc(source_file);
+	src = readSource(filename, &srcLen);
+	if (!src) exit(1);
+	line = 1;
+	seekChar(0);
 }
 
 void closeFile() {
-	if (source_file) fclose(source_file);
+	free(src);
+	src = NULL;
+	srcLen = 0;
+	free(tokens);
+	tokens = NULL;
+	numTokens = tokenPos = 0;
 }
 
 void nextChar() {
+	STAT_INC(chars);
 	if (current == '\n') line++;
-	current = lookahead;
-	if (current == EOF) isEOF = 1;
-	lookahead = fgetc(source_file);
+	seekChar(srcPos + 1);
 }
 
 void printToken(Token token) {
 	const char* tokenNames[] = { "INTEGER", "FLOAT", "STRING", "CHAR", "COMMENT",
 		"TYPE", "RESERVED", "OPERATOR", "IDENTIFIER" };
-	printf("%s: %s", tokenNames[token.type], token.lexeme);
+	sinkStr(out, tokenNames[token.type]);
+	sinkStr(out, ": ");
+	sinkStr(out, token.lexeme);
 	if (token.type == TYPE_INTEGER) {
-		printf(" (value: %d)", token.value);
+		sinkStr(out, " (value: ");
+		sinkInt(out, token.value);
+		sinkChar(out, ')');
 	} else if (token.type == TYPE_FLOAT) {
-		printf(" (value: %.2f)", token.fvalue);
-	} printf("\n");
+		sinkStr(out, " (value: ");
+		sinkFloat(out, token.fvalue);
+		sinkChar(out, ')');
+	} sinkChar(out, '\n');
 }
 
 int isOperator(char c) {
@@ -50,6 +90,29 @@ int isOperator(char c) {
 		c == '!' || c == '&' || c == '|' || c == '%');
 }
 
+OperatorType operatorCode(char c) {
+	switch (c) {
+	case '+': return OP_PLUS;
+	case '-': return OP_MINUS;
+	case '*': return OP_STAR;
+	case '/': return OP_SLASH;
+	case '%': return OP_PERCENT;
+	case '(': return OP_LPAREN;
+	case ')': return OP_RPAREN;
+	case '{': return OP_LBRACE;
+	case '}': return OP_RBRACE;
+	case ';': return OP_SEMI;
+	case ',': return OP_COMMA;
+	case '=': return OP_ASSIGN;
+	case '<': return OP_LT;
+	case '>': return OP_GT;
+	case '!': return OP_NOT;
+	case '&': return OP_BITAND;
+	case '|': return OP_BITOR;
+	default: return OP_NONE;
+	}
+}
+
 int isReserved(char* word) {
 	const char* reserve[] = {
    "break","case", "continue", "class", "catch",
@@ -75,9 +138,11 @@ int isType(char* word) {
 	} return 0;
 }
 
-Token nextToken() {
+Token lexToken() {
 	Token token;
 	token.line = line;
+	token.start = token.end = srcPos;
+	token.op = OP_NONE;
     memset(token.lexeme, 0, sizeof(token.lexeme));
 	token.value = 0;
 	token.fvalue = 0.0;
@@ -87,6 +152,8 @@ Token nextToken() {
 		return token;
 	} // skip whitespace 
 	while (!isEOF && (current == ' ' || current == '\t' || current == '\n' || current == '\r')) nextChar();
+	token.line = line;
+	token.start = srcPos;
 	if (isEOF) {
 		token.type = TYPE_EOF;
 		strcpy(token.lexeme, "EOF");
@@ -135,7 +202,7 @@ Token nextToken() {
 		token.lexeme[1] = '\0';
 		token.value = (int)current;
 		nextChar();
-		if (current != '\'') return nextToken();
+		if (current != '\'') return lexToken();
 		nextChar();
 		token.type = TYPE_CHAR;
 		return token;
@@ -144,7 +211,7 @@ Token nextToken() {
 		while (!isEOF && current != '\n') nextChar();
 		token.type = TYPE_COMMENT;
 		strcpy(token.lexeme, "//...");
-		return nextToken();
+		return lexToken();
 	} else if (current == '/' && lookahead == '*') {
 		while (!(current == '*' && lookahead == '/') && !isEOF) {
 			nextChar();
@@ -158,7 +225,7 @@ Token nextToken() {
 		}
 		token.type = TYPE_COMMENT;
 		strcpy(token.lexeme, "/*...*/");
-		return nextToken();
+		return lexToken();
 	} // handle reserved/type/identifier
 	if (isalpha(current) || current == '_') {
 		int i = 0;
@@ -173,46 +240,36 @@ Token nextToken() {
 	} // handle operator
 	if (isOperator(current)) {
 		token.type = TYPE_OPERATOR;
-		memset(token.lexeme, 0, sizeof(token.lexeme));
+		token.op = operatorCode(current);
 		token.lexeme[0] = current;
 		token.lexeme[1] = '\0';
 		int twoCh = 0; // track if 2char op
 		switch (current) {
 		case '=':
-			if (lookahead == '=') { strcpy(token.lexeme, "=="); twoCh = 1; } break;
+			if (lookahead == '=') { strcpy(token.lexeme, "=="); token.op = OP_EQ; twoCh = 1; } break;
 		case '!':
-			if (lookahead == '=') { strcpy(token.lexeme, "!=");	twoCh = 1; } break;
+			if (lookahead == '=') { strcpy(token.lexeme, "!="); token.op = OP_NE; twoCh = 1; } break;
 		case '+':
-			if (lookahead == '=') { strcpy(token.lexeme, "+="); twoCh = 1; }
-			else if (lookahead == '+') { strcpy(token.lexeme, "++"); twoCh = 1; } break;
+			if (lookahead == '=') { strcpy(token.lexeme, "+="); token.op = OP_ADD_ASSIGN; twoCh = 1; }
+			else if (lookahead == '+') { strcpy(token.lexeme, "++"); token.op = OP_INC; twoCh = 1; } break;
 		case '-':
-			if (lookahead == '=') { strcpy(token.lexeme, "-="); twoCh = 1; }
-			else if (lookahead == '-') { strcpy(token.lexeme, "--"); twoCh = 1; } break;
+			if (lookahead == '=') { strcpy(token.lexeme, "-="); token.op = OP_SUB_ASSIGN; twoCh = 1; }
+			else if (lookahead == '-') { strcpy(token.lexeme, "--"); token.op = OP_DEC; twoCh = 1; } break;
 		case '>':
-			if (lookahead == '=') { strcpy(token.lexeme, ">="); twoCh = 1; } break;
+			if (lookahead == '=') { strcpy(token.lexeme, ">="); token.op = OP_GE; twoCh = 1; } break;
 		case '<':
-			if (lookahead == '=') {
-				strcpy(token.lexeme, "<=");	twoCh = 1; } break;
+			if (lookahead == '=') { strcpy(token.lexeme, "<="); token.op = OP_LE; twoCh = 1; } break;
 		case '&':
-			if (lookahead == '&') {
-				strcpy(token.lexeme, "&&"); twoCh = 1; } break;
+			if (lookahead == '&') { strcpy(token.lexeme, "&&"); token.op = OP_AND; twoCh = 1; } break;
 		case '|':
-			if (lookahead == '|') {
-				strcpy(token.lexeme, "||"); twoCh = 1; } break;
+			if (lookahead == '|') { strcpy(token.lexeme, "||"); token.op = OP_OR; twoCh = 1; } break;
 		case '%':
-			if (lookahead == '=') { strcpy(token.lexeme,"%="); twoCh = 1; }
-			else { strcpy(token.lexeme, "%"); } break;
+			if (lookahead == '=') { strcpy(token.lexeme, "%="); token.op = OP_MOD_ASSIGN; twoCh = 1; } break;
 		case '*':
-			if (lookahead == '=') { strcpy(token.lexeme, "*="); twoCh = 1; }
-			else { strcpy(token.lexeme, "*"); } break;
+			if (lookahead == '=') { strcpy(token.lexeme, "*="); token.op = OP_MUL_ASSIGN; twoCh = 1; } break;
 		case '/':
-			if (lookahead == '=') { strcpy(token.lexeme, "/="); twoCh = 1; }
-			else { strcpy(token.lexeme, "/"); } break;
-		case ';':
-			break;	
+			if (lookahead == '=') { strcpy(token.lexeme, "/="); token.op = OP_DIV_ASSIGN; twoCh = 1; } break;
 		default: // single op
-			token.lexeme[0] = current;
-			token.lexeme[1] = '\0';
 			break;
 		} if (twoCh) {
 			nextChar();
@@ -222,4 +279,119 @@ Token nextToken() {
 	token.type = TYPE_EOF;
 	strcpy(token.lexeme, "EOF");
 	return token;
-}
\ No newline at end of file
+}
+
+// lex the rest of the file up front, nextToken() then replays it
+void bufferTokens() {
+	int cap = 256;
+	Token* buf = malloc(cap * sizeof(Token));
+	chargeAlloc(cap * sizeof(Token));
+	int n = 0;
+	while (1) {
+		if (n == cap) {
+			buf = realloc(buf, cap * 2 * sizeof(Token));
+			chargeAlloc(cap * sizeof(Token));
+			cap *= 2;
+		} buf[n] = lexToken();
+		buf[n].end = srcPos;
+		if (buf[n++].type == TYPE_EOF) break;
+	} tokens = buf;
+	numTokens = n;
+	tokenPos = 0;
+}
+
+// index of the token starting at pos, or -1
+int findTokenAt(Token* list, int n, int pos) {
+	int lo = 0, hi = n - 1;
+	while (lo <= hi) {
+		int mid = (lo + hi) / 2;
+		if (list[mid].start == pos) return mid;
+		if (list[mid].start < pos) lo = mid + 1;
+		else hi = mid - 1;
+	} return -1;
+}
+
+int countLines(char* text, int len) {
+	int n = 0;
+	for (int i = 0; i < len; i++) if (text[i] == '\n') n++;
+	return n;
+}
+
+// swap in edited source, re-lexing only the damaged region; takes ownership of text
+int relexBuffer(char* text, int len) {
+	int prefix = 0, suffix = 0;
+	while (prefix < srcLen && prefix < len && src[prefix] == text[prefix]) prefix++;
+	while (suffix < srcLen - prefix && suffix < len - prefix &&
+		src[srcLen - 1 - suffix] == text[len - 1 - suffix]) suffix++;
+	int delta = len - srcLen;
+	int lineDelta = countLines(text + prefix, len - suffix - prefix) -
+		countLines(src + prefix, srcLen - suffix - prefix);
+	// restart one token before the first one touching the edit
+	int k = 0;
+	while (k < numTokens - 1 && tokens[k].end < prefix) k++;
+	if (k > 0) k--;
+	int cap = 64, n = 0, j = -1;
+	Token* fresh = malloc(cap * sizeof(Token));
+	chargeAlloc(cap * sizeof(Token));
+	free(src);
+	src = text;
+	srcLen = len;
+	if (k == 0) { // edit before the first token, old offsets mean nothing here
+		line = 1;
+		seekChar(0);
+	} else {
+		line = tokens[k].line;
+		seekChar(tokens[k].start);
+	}
+	while (1) {
+		Token tok = lexToken();
+		tok.end = srcPos;
+		// past the edit, an old token at the same spot means the rest is unchanged
+		if (tok.start >= len - suffix) j = findTokenAt(tokens, numTokens, tok.start - delta);
+		if (j >= 0 && tokens[j].type == tok.type && strcmp(tokens[j].lexeme, tok.lexeme) == 0) break;
+		j = -1;
+		if (n == cap) {
+			fresh = realloc(fresh, cap * 2 * sizeof(Token));
+			chargeAlloc(cap * sizeof(Token));
+			cap *= 2;
+		} fresh[n++] = tok;
+		if (tok.type == TYPE_EOF) break;
+	} // splice: tokens[0, k) + fresh + shifted tokens[j, end)
+	int tail = j >= 0 ? numTokens - j : 0;
+	if (k + n + tail > numTokens) {
+		tokens = realloc(tokens, (k + n + tail) * sizeof(Token));
+		chargeAlloc((k + n + tail - numTokens) * sizeof(Token));
+	}
+	if (tail > 0) memmove(&tokens[k + n], &tokens[j], tail * sizeof(Token));
+	memcpy(&tokens[k], fresh, n * sizeof(Token));
+	if (delta != 0 || lineDelta != 0) {
+		for (int i = k + n; i < k + n + tail; i++) {
+			tokens[i].start += delta;
+			tokens[i].end += delta;
+			tokens[i].line += lineDelta;
+		}
+	} free(fresh);
+	numTokens = k + n + tail;
+	tokenPos = 0;
+	return n;
+}
+
+void rewindTokens() {
+	tokenPos = 0;
+}
+
+int tokenCount() {
+	return numTokens;
+}
+
+Token* tokenAt(int i) {
+	if (i < 0 || i >= numTokens) return &tokens[numTokens - 1];
+	return &tokens[i];
+}
+
+Token nextToken() {
+	STAT_INC(tokens);
+	if (tokens == NULL) return lexToken();
+	if (tokenPos < numTokens) return tokens[tokenPos++];
+	return tokens[numTokens - 1];
+}
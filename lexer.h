@@ -15,27 +15,50 @@ typedef enum {
     TYPE_EOF,
 } TokenType;
 
+// operator codes, resolved once by the lexer
+typedef enum {
+    OP_NONE,
+    OP_PLUS, OP_MINUS, OP_STAR, OP_SLASH, OP_PERCENT,
+    OP_LPAREN, OP_RPAREN, OP_LBRACE, OP_RBRACE,
+    OP_SEMI, OP_COMMA, OP_ASSIGN, OP_LT, OP_GT,
+    OP_NOT, OP_BITAND, OP_BITOR,
+    OP_EQ, OP_NE, OP_LE, OP_GE, OP_AND, OP_OR, OP_INC, OP_DEC,
+    OP_ADD_ASSIGN, OP_SUB_ASSIGN, OP_MUL_ASSIGN, OP_DIV_ASSIGN, OP_MOD_ASSIGN,
+} OperatorType;
+
 // struct
 typedef struct {
     TokenType type;
+    OperatorType op;
     char lexeme[256];
     int value;
     float fvalue;
     int line;
+    int start; // source offsets
+    int end;
 } Token;
 
 // global var
-extern Token curr;
+extern _Thread_local Token curr;
 
 // func dec
+char* readSource(char* filename, int* len);
 void openFile(char* filename);
 void closeFile();
 void nextChar ();
 void printToken(Token token);
 int isOperator(char c);
+OperatorType operatorCode(char c);
 int isReserved(char* word);
 int isType(char* word);
+Token lexToken();
 Token nextToken();
+// token stream
+void bufferTokens();
+int tokenCount();
+Token* tokenAt(int i);
+int relexBuffer(char* text, int len);
+void rewindTokens();
 
 
 #endif
\ No newline at end of file
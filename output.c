@@ -0,0 +1,142 @@
+// output.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <unistd.h>
+#include "output.h"
+
+#define SINK_SIZE 65536
+
+_Thread_local Sink* out = NULL;
+OutputFormat outputFormat = FORMAT_TEXT;
+
+void sinkInit(Sink* sink, int fd) {
+    sink->fd = fd;
+    sink->cap = SINK_SIZE;
+    sink->buf = malloc(sink->cap);
+    sink->len = 0;
+}
+
+// fd sinks only, memory sinks keep everything
+void sinkFlush(Sink* sink) {
+    if (sink->fd < 0) return;
+    size_t done = 0;
+    while (done < sink->len) {
+        ssize_t n = write(sink->fd, sink->buf + done, sink->len - done);
+        if (n <= 0) break;
+        done += n;
+    } sink->len = 0;
+}
+
+void sinkFree(Sink* sink) {
+    sinkFlush(sink);
+    free(sink->buf);
+    sink->buf = NULL;
+    sink->len = sink->cap = 0;
+}
+
+void sinkBytes(Sink* sink, const void* data, size_t len) {
+    if (sink->len + len > sink->cap) {
+        if (sink->fd >= 0) {
+            sinkFlush(sink);
+            if (len > sink->cap) { // too big to buffer, write straight through
+                ssize_t n;
+                for (size_t done = 0; done < len; done += n) {
+                    n = write(sink->fd, (const char*)data + done, len - done);
+                    if (n <= 0) return;
+                } return;
+            }
+        } else {
+            while (sink->len + len > sink->cap) sink->cap *= 2;
+            sink->buf = realloc(sink->buf, sink->cap);
+        }
+    } memcpy(sink->buf + sink->len, data, len);
+    sink->len += len;
+}
+
+void sinkStr(Sink* sink, const char* s) {
+    sinkBytes(sink, s, strlen(s));
+}
+
+void sinkChar(Sink* sink, char c) {
+    if (sink->len == sink->cap) sinkBytes(sink, &c, 1);
+    else sink->buf[sink->len++] = c;
+}
+
+void sinkInt(Sink* sink, long v) {
+    char digits[24];
+    int i = sizeof(digits);
+    unsigned long u = v < 0 ? 0UL - (unsigned long)v : (unsigned long)v;
+    do {
+        digits[--i] = '0' + u % 10;
+        u /= 10;
+    } while (u != 0);
+    if (v < 0) digits[--i] = '-';
+    sinkBytes(sink, digits + i, sizeof(digits) - i);
+}
+
+// same digits as printf("%.2f"): v * 100 is exact in a double, ties go to even
+void sinkFloat(Sink* sink, float v) {
+    double a = fabs((double)v);
+    if (isnan(v) || isinf(v) || a >= 1e15) {
+        char text[64];
+        snprintf(text, sizeof(text), "%.2f", v);
+        sinkStr(sink, text);
+        return;
+    } double scaled = a * 100.0;
+    double whole = floor(scaled);
+    double frac = scaled - whole;
+    unsigned long long cents = (unsigned long long)whole;
+    if (frac > 0.5 || (frac == 0.5 && (cents & 1))) cents++;
+    if (signbit(v)) sinkChar(sink, '-');
+    sinkInt(sink, (long)(cents / 100));
+    sinkChar(sink, '.');
+    sinkChar(sink, '0' + (cents / 10) % 10);
+    sinkChar(sink, '0' + cents % 10);
+}
+
+void sinkJsonStr(Sink* sink, const char* s) {
+    const char* hex = "0123456789abcdef";
+    sinkChar(sink, '"');
+    for (; *s; s++) {
+        unsigned char c = *s;
+        if (c == '"' || c == '\\') {
+            sinkChar(sink, '\\');
+            sinkChar(sink, c);
+        } else if (c < 0x20) {
+            sinkStr(sink, "\\u00");
+            sinkChar(sink, hex[c >> 4]);
+            sinkChar(sink, hex[c & 15]);
+        } else sinkChar(sink, c);
+    } sinkChar(sink, '"');
+}
+
+// binary dump fields, little-endian
+void sinkU8(Sink* sink, int v) {
+    sinkChar(sink, (char)v);
+}
+
+void sinkU16(Sink* sink, int v) {
+    unsigned char b[2] = { v & 0xff, (v >> 8) & 0xff };
+    sinkBytes(sink, b, 2);
+}
+
+void sinkI32(Sink* sink, int v) {
+    uint32_t u = (uint32_t)v;
+    unsigned char b[4] = { u & 0xff, (u >> 8) & 0xff, (u >> 16) & 0xff, u >> 24 };
+    sinkBytes(sink, b, 4);
+}
+
+void sinkF32(Sink* sink, float v) {
+    uint32_t u;
+    memcpy(&u, &v, 4);
+    sinkI32(sink, (int)u);
+}
+
+void sinkBinStr(Sink* sink, const char* s) {
+    size_t len = strlen(s);
+    sinkU16(sink, (int)len);
+    sinkBytes(sink, s, len);
+}
@@ -0,0 +1,39 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stddef.h>
+
+typedef enum {
+    FORMAT_TEXT,
+    FORMAT_JSON,
+    FORMAT_BINARY,
+} OutputFormat;
+
+// buffered writer, flushed to fd with write() or grown in memory when fd < 0
+typedef struct {
+    int fd;
+    char* buf;
+    size_t len;
+    size_t cap;
+} Sink;
+
+extern _Thread_local Sink* out; // report and diagnostics
+extern OutputFormat outputFormat;
+
+// func dec
+void sinkInit(Sink* sink, int fd);
+void sinkFlush(Sink* sink);
+void sinkFree(Sink* sink);
+void sinkBytes(Sink* sink, const void* data, size_t len);
+void sinkStr(Sink* sink, const char* s);
+void sinkChar(Sink* sink, char c);
+void sinkInt(Sink* sink, long v);
+void sinkFloat(Sink* sink, float v);
+void sinkJsonStr(Sink* sink, const char* s);
+void sinkU8(Sink* sink, int v);
+void sinkU16(Sink* sink, int v);
+void sinkI32(Sink* sink, int v);
+void sinkF32(Sink* sink, float v);
+void sinkBinStr(Sink* sink, const char* s);
+
+#endif
@@ -3,7 +3,19 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <pthread.h>
 #include "lexer.h"
+#include "parser.h"
+#include "stats.h"
+#include "profile.h"
+#include "budget.h"
+#include "output.h"
+#include "check.h"
 
 typedef struct Symbol {
     char name[256];
@@ -29,13 +41,39 @@ typedef struct StackFrame {
     struct StackFrame* prev;
 } StackFrame;
 
-// global table
-Symbol* table = NULL;
-Function* funcTable = NULL;
-Function* currentFunc = NULL;
-StackFrame* currentFrame = NULL;
-int returnValue = 0;
-int inFunc = 0;
+// call graph, one node per top-level function
+typedef struct CallSite {
+    char name[256];
+    struct CallNode* target; // resolved once the scan is done
+    struct CallSite* next;
+} CallSite;
+
+typedef struct CallNode {
+    char name[256];
+    int reachable;
+    struct CallSite* calls;
+    struct CallNode* next;
+    struct CallNode* bucketNext; // callIndex chain
+    struct CallNode* pending; // markReachable worklist
+} CallNode;
+
+// global table, execution state is per thread so runs can share one program
+_Thread_local Symbol* table = NULL;
+_Thread_local Function* funcTable = NULL;
+_Thread_local Function* currentFunc = NULL;
+_Thread_local StackFrame* currentFrame = NULL;
+_Thread_local int returnValue = 0;
+_Thread_local int inFunc = 0;
+_Thread_local int exprFailed = 0; // set on expression errors, expressions have no failure return
+_Thread_local Override* overrides = NULL;
+_Thread_local int numOverrides = 0;
+Sink stdoutSink;
+// shared, read-only while runs execute
+CallNode* callGraph = NULL;
+CallNode** callIndex = NULL; // hash of callGraph by name
+unsigned callIndexSize = 0;
+int keepUnused = 0;
+int reportUnused = 0;
 
 // func dec
 int program();
@@ -45,7 +83,10 @@ int expression();
 void printTable();
 void addSymbol(char* name, char* type, int val);
 void syntaxError(char* msg);
+void diagnostic(char* msg, int line);
+int checkOverrides();
 Symbol* findSymbol(char* name);
+int isOp(OperatorType op);
 
 // operator precedence
 int logicalOr();
@@ -65,104 +106,420 @@ int returnStat();
 int funcCall(char* name);
 void addFunc(char*name, char* returnType);
 Function* findFunc(char* name);
+// call graph prototypes
+void buildCallGraph();
+CallNode* findCallNode(char* name);
+unsigned hashName(char* name);
+void markReachable(CallNode* node);
+int isReachable(char* name);
+int skipFunction();
+void printUnused();
+// driver prototypes
+int parse();
+void report(int ok);
+void freeTables();
+void freeCallGraph();
+int execute();
+int runsMain(char* runsFile, int numThreads);
+void watchFile(char* filename, double fullMs, int statsMode);
+void watchTiming(int relexed, double lexMs, double ms, double fullMs);
 
 int main(int argc, char* argv[]) {
-    if (argc != 2) return 1;
-    openFile(argv[1]);
-    curr = nextToken(); // get first
-    if (program()) {
-        printf("Parsing successful\n");
+    char* filename = NULL;
+    int watch = 0, statsMode = 0, profEvery = 0, numThreads = 4;
+    char* profOut = NULL;
+    char* runsFile = NULL;
+    sinkInit(&stdoutSink, STDOUT_FILENO);
+    out = &stdoutSink;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--report-unused") == 0) reportUnused = 1;
+        else if (strcmp(argv[i], "--keep-unused") == 0) keepUnused = 1;
+        else if (strcmp(argv[i], "--watch") == 0) watch = 1;
+        else if (strcmp(argv[i], "--stats") == 0) statsMode = 1;
+        else if (strcmp(argv[i], "--stats=json") == 0) statsMode = 2;
+        else if (strncmp(argv[i], "--profile=", 10) == 0) profOut = argv[i] + 10;
+        else if (strncmp(argv[i], "--profile-every=", 16) == 0) profEvery = atoi(argv[i] + 16);
+        else if (strncmp(argv[i], "--max-statements=", 17) == 0) budget.maxStatements = atol(argv[i] + 17);
+        else if (strncmp(argv[i], "--max-depth=", 12) == 0) budget.maxDepth = atoi(argv[i] + 12);
+        else if (strncmp(argv[i], "--max-bytes=", 12) == 0) budget.maxBytes = atol(argv[i] + 12);
+        else if (strncmp(argv[i], "--runs=", 7) == 0) runsFile = argv[i] + 7;
+        else if (strncmp(argv[i], "--threads=", 10) == 0) numThreads = atoi(argv[i] + 10);
+        else if (strcmp(argv[i], "--format=text") == 0) outputFormat = FORMAT_TEXT;
+        else if (strcmp(argv[i], "--format=json") == 0) outputFormat = FORMAT_JSON;
+        else if (strcmp(argv[i], "--format=binary") == 0) outputFormat = FORMAT_BINARY;
+        else if (strcmp(argv[i], "--set") == 0 && i + 1 < argc) {
+            overrides = realloc(overrides, (numOverrides + 1) * sizeof(Override));
+            if (!parseOverride(argv[++i], &overrides[numOverrides++])) {
+                char msg[300];
+                snprintf(msg, sizeof(msg), "Bad override '%s'", argv[i]);
+                diagnostic(msg, 0);
+                sinkFlush(out);
+                return 1;
+            }
+        } else if (filename == NULL) filename = argv[i];
+        else return 1;
+    } if (filename == NULL || (runsFile && (profOut || watch || statsMode)) || numThreads < 1) return 1;
+    checkThreads = numThreads;
+    openFile(filename);
+    if (outputFormat == FORMAT_BINARY) sinkBytes(out, "PSYM\1", 5); // magic, version
+    double start = nowMs();
+    bufferTokens();
+    STAT_ADD(lexMs, nowMs() - start);
+    if (runsFile) {
+        int status = runsMain(runsFile, numThreads);
+        sinkFree(out);
+        closeFile();
+        return status;
+    }
+    if (profOut) profStart(profOut, profEvery);
+    int ok = parse();
+    profStop();
+    double fullMs = nowMs() - start;
+    report(ok);
+    if (statsMode || ok < 0) printStats(statsMode == 2);
+    if (profOut) printProfile();
+    if (watch) watchFile(filename, fullMs, statsMode);
+    sinkFree(out);
+    closeFile();
+    return ok < 0 ? 2 : 0;
+}
+
+// returns 1 ok, 0 syntax error, -1 budget exceeded
+int parse() {
+    double start = nowMs();
+    buildCallGraph();
+    STAT_ADD(graphMs, nowMs() - start);
+    if (!checkProgram()) return 0;
+    return execute();
+}
+
+// run the buffered program against this thread's tables
+// the budget starts here, the shared token buffer and call graph are not charged to it
+int execute() {
+    volatile double start = nowMs();
+    resetBudget();
+    rewindTokens();
+    exprFailed = 0;
+    for (int i = 0; i < numOverrides; i++) overrides[i].used = 0;
+    if (setjmp(budgetAbort)) {
+        STAT_ADD(parseMs, nowMs() - start);
+        return -1;
+    } curr = nextToken(); // get first
+    int ok = program();
+    if (ok && !checkOverrides()) ok = 0;
+    STAT_ADD(parseMs, nowMs() - start);
+    return ok;
+}
+
+void report(int ok) {
+    if (outputFormat == FORMAT_JSON) {
+        sinkStr(out, ok < 0 ? "{\"status\":\"aborted\"" : ok ? "{\"status\":\"ok\"" : "{\"status\":\"failed\"");
+        if (ok < 0) {
+            sinkStr(out, ",\"reason\":");
+            sinkJsonStr(out, budgetReason);
+        } else if (ok) {
+            printTable();
+            if (reportUnused) printUnused();
+        } sinkStr(out, "}\n");
+    } else if (outputFormat == FORMAT_BINARY) {
+        sinkU8(out, 'S');
+        sinkU8(out, ok < 0 ? 2 : ok);
+        if (ok < 0) sinkBinStr(out, budgetReason);
+        else if (ok) {
+            printTable();
+            if (reportUnused) printUnused();
+        } sinkU8(out, 'Z');
+    } else if (ok < 0) {
+        sinkStr(out, "Execution aborted: ");
+        sinkStr(out, budgetReason);
+        sinkChar(out, '\n');
+    } else if (ok) {
+        sinkStr(out, "Parsing successful\n");
         printTable();
+        if (reportUnused) printUnused();
     } else {
-        printf("Parsing failed\n");
-    } closeFile();
-    return 0;
+        sinkStr(out, "Parsing failed\n");
+    } sinkFlush(out);
+}
+
+// "name=value", value a decimal int
+int parseOverride(char* text, Override* override) {
+    char* eq = strchr(text, '=');
+    if (eq == NULL || eq == text || eq - text >= (int)sizeof(override->name)) return 0;
+    char* end;
+    errno = 0;
+    long value = strtol(eq + 1, &end, 10);
+    if (end == eq + 1 || *end != '\0' || errno == ERANGE || value < INT_MIN || value > INT_MAX) return 0;
+    memcpy(override->name, text, eq - text);
+    override->name[eq - text] = '\0';
+    override->value = (int)value;
+    override->used = 0;
+    return 1;
+}
+
+// an override no global declaration took is a typo, fail the run rather than report defaults
+int checkOverrides() {
+    int ok = 1;
+    for (int i = 0; i < numOverrides; i++) {
+        if (overrides[i].used) continue;
+        int taken = 0; // a later duplicate of the same name took the value instead
+        for (int j = 0; j < numOverrides; j++) {
+            if (overrides[j].used && strcmp(overrides[j].name, overrides[i].name) == 0) taken = 1;
+        } if (taken) continue;
+        char msg[300];
+        snprintf(msg, sizeof(msg), "No global '%s' for override", overrides[i].name);
+        diagnostic(msg, 0);
+        ok = 0;
+    } return ok;
+}
+
+// execute the shared program once, capturing the report into run->output
+int runProgram(Run* run) {
+    overrides = run->overrides;
+    numOverrides = run->numOverrides;
+    Sink sink;
+    sinkInit(&sink, -1);
+    out = &sink;
+    resetStats();
+    run->status = execute();
+    report(run->status);
+    run->output = sink.buf;
+    run->outputLen = sink.len;
+    out = NULL;
+    freeTables();
+    overrides = NULL;
+    numOverrides = 0;
+    return run->status;
+}
+
+typedef struct {
+    Run* runs;
+    int numRuns;
+    int next;
+    pthread_mutex_t lock;
+} RunQueue;
+
+void* runWorker(void* arg) {
+    RunQueue* queue = arg;
+    while (1) {
+        pthread_mutex_lock(&queue->lock);
+        int i = queue->next++;
+        pthread_mutex_unlock(&queue->lock);
+        if (i >= queue->numRuns) return NULL;
+        runProgram(&queue->runs[i]);
+    }
+}
+
+// token stream and call graph must already be built; each run gets its own tables
+void runAll(Run* runs, int numRuns, int numThreads) {
+    RunQueue queue = { .runs = runs, .numRuns = numRuns, .next = 0 };
+    pthread_mutex_init(&queue.lock, NULL);
+    if (numThreads > numRuns) numThreads = numRuns;
+    pthread_t* threads = malloc(numThreads * sizeof(pthread_t));
+    for (int i = 0; i < numThreads; i++) pthread_create(&threads[i], NULL, runWorker, &queue);
+    for (int i = 0; i < numThreads; i++) pthread_join(threads[i], NULL);
+    free(threads);
+    pthread_mutex_destroy(&queue.lock);
+}
+
+// one run per line of runsFile, each line a list of name=value overrides on top of --set
+int runsMain(char* runsFile, int numThreads) {
+    FILE* file = fopen(runsFile, "r");
+    if (!file) return 1;
+    Run* runs = NULL;
+    int numRuns = 0;
+    char text[4096];
+    while (fgets(text, sizeof(text), file)) {
+        runs = realloc(runs, (numRuns + 1) * sizeof(Run));
+        Run* run = &runs[numRuns++];
+        memset(run, 0, sizeof(Run));
+        if (numOverrides > 0) { // --set applies to every run, the line's own overrides win
+            run->overrides = malloc(numOverrides * sizeof(Override));
+            memcpy(run->overrides, overrides, numOverrides * sizeof(Override));
+            run->numOverrides = numOverrides;
+        }
+        char* save = NULL;
+        for (char* word = strtok_r(text, " \t\r\n", &save); word != NULL; word = strtok_r(NULL, " \t\r\n", &save)) {
+            run->overrides = realloc(run->overrides, (run->numOverrides + 1) * sizeof(Override));
+            if (!parseOverride(word, &run->overrides[run->numOverrides++])) {
+                char msg[300];
+                snprintf(msg, sizeof(msg), "Bad override '%s' on run %d", word, numRuns);
+                diagnostic(msg, 0);
+                for (int i = 0; i < numRuns; i++) free(runs[i].overrides);
+                free(runs);
+                fclose(file);
+                return 1;
+            }
+        }
+    } fclose(file);
+    buildCallGraph();
+    if (!checkProgram()) { // static errors do not depend on overrides, report them once
+        report(0);
+        for (int i = 0; i < numRuns; i++) free(runs[i].overrides);
+        free(runs);
+        freeCallGraph();
+        return 0;
+    } runAll(runs, numRuns, numThreads);
+    int status = 0;
+    for (int i = 0; i < numRuns; i++) {
+        if (outputFormat == FORMAT_JSON) {
+            sinkStr(out, "{\"run\":");
+            sinkInt(out, i + 1);
+            sinkStr(out, "}\n");
+        } else if (outputFormat == FORMAT_BINARY) {
+            sinkU8(out, 'N');
+            sinkI32(out, i + 1);
+        } else {
+            sinkStr(out, "Run ");
+            sinkInt(out, i + 1);
+            sinkStr(out, ":\n");
+        } sinkBytes(out, runs[i].output, runs[i].outputLen);
+        if (outputFormat == FORMAT_TEXT) sinkChar(out, '\n');
+        if (runs[i].status < 0) status = 2;
+        free(runs[i].output);
+        free(runs[i].overrides);
+    } free(runs);
+    freeCallGraph();
+    return status;
+}
+
+// poll for saves, re-lex only the edited region and re-run the parse
+void watchFile(char* filename, double fullMs, int statsMode) {
+    struct stat st;
+    if (stat(filename, &st) != 0) return;
+    struct timespec last = st.st_mtim;
+    off_t lastSize = st.st_size;
+    fflush(stdout);
+    while (1) {
+        usleep(200000);
+        if (stat(filename, &st) != 0) continue;
+        if (st.st_mtim.tv_sec == last.tv_sec && st.st_mtim.tv_nsec == last.tv_nsec &&
+            st.st_size == lastSize) continue;
+        last = st.st_mtim;
+        lastSize = st.st_size;
+        int len;
+        char* text = readSource(filename, &len);
+        if (!text) continue;
+        resetStats();
+        double start = nowMs();
+        int relexed = relexBuffer(text, len);
+        double lexMs = nowMs() - start;
+        STAT_ADD(lexMs, lexMs);
+        freeTables();
+        freeCallGraph();
+        int ok = parse();
+        double ms = nowMs() - start;
+        if (outputFormat == FORMAT_TEXT) sinkChar(out, '\n');
+        report(ok);
+        watchTiming(relexed, lexMs, ms, fullMs);
+        if (statsMode || ok < 0) printStats(statsMode == 2);
+        fflush(stdout);
+    }
+}
+
+// one timing record per re-parse, in the report's format
+void watchTiming(int relexed, double lexMs, double ms, double fullMs) {
+    char text[256];
+    if (outputFormat == FORMAT_JSON) {
+        snprintf(text, sizeof(text), "{\"relexed\":%d,\"tokens\":%d,\"lex_ms\":%.3f,\"total_ms\":%.3f,\"full_ms\":%.3f}\n",
+            relexed, tokenCount(), lexMs, ms, fullMs);
+        sinkStr(out, text);
+    } else if (outputFormat == FORMAT_BINARY) {
+        sinkU8(out, 'W');
+        sinkI32(out, relexed);
+        sinkI32(out, tokenCount());
+        sinkF32(out, lexMs);
+        sinkF32(out, ms);
+        sinkF32(out, fullMs);
+    } else {
+        snprintf(text, sizeof(text), "\nRe-lexed %d of %d tokens in %.3f ms, re-parsed in %.3f ms total (full parse %.3f ms)\n",
+            relexed, tokenCount(), lexMs, ms, fullMs);
+        sinkStr(out, text);
+    } sinkFlush(out);
 }
 
 // func implementation
 int program() {
      while (1) {
         if (curr.type == TYPE_EOF) return 1;
-        if (!statement()) return 0;
+        budgetCheck();
+        if (!statement() || exprFailed) return 0;
     } return 1;
 }
 
 int statement() {
+    if (exprFailed) return 0;
+    STAT_INC(statements);
+    budgetStatements++;
+    if (profiling) profTick();
      if (curr.type == TYPE_TYPE) {
         return declaration();
     } else if (curr.type == TYPE_IDENTIFIER) {
         char name[256];
         strcpy(name, curr.lexeme);
         curr = nextToken();
-        if (curr.type == TYPE_OPERATOR && strcmp(curr.lexeme, "(") == 0) {
-            Function* func = funcTable;
-            while (func != NULL && strcmp(func->name, name) != 0) func = func->next;
-            if (func == NULL) {
-                syntaxError("Undefined function");
-                return 0;
-            } curr = nextToken();
-            Symbol* param = func->params;
-            while (curr.type != TYPE_OPERATOR || strcmp(curr.lexeme, ")") != 0) {
-                int argValue = expression();
-                if (param != NULL) {
-                    if (strcmp(param->type, "int") == 0) param->intVal = argValue;
-                    else if (strcmp(param->type, "float") == 0) param->floatVal = (float)argValue;
-                    else if (strcmp(param->type, "char") == 0) param->charVal = (char)argValue;
-                    param = param->next;
-                } if (curr.type == TYPE_OPERATOR && strcmp(curr.lexeme, ",") == 0) curr = nextToken();
-            } if (curr.type != TYPE_OPERATOR || strcmp(curr.lexeme, ")") != 0) return 0;
-            curr = nextToken();
+        if (isOp(OP_LPAREN)) {
+            if (!funcCall(name)) return 0;
             returnValue = 0;
-            if (curr.type == TYPE_OPERATOR && strcmp(curr.lexeme, ";") == 0) curr = nextToken();
+            if (isOp(OP_SEMI)) curr = nextToken();
             return 1;
         } else {
             if (curr.type != TYPE_OPERATOR ||
-                (strcmp(curr.lexeme, "=") != 0 &&
-                strcmp(curr.lexeme, "+=") != 0 &&
-                strcmp(curr.lexeme, "-=") != 0 && 
-                strcmp(curr.lexeme, "*=") != 0 &&
-                strcmp(curr.lexeme, "/=") != 0 &&
-                strcmp(curr.lexeme, "%=") != 0)) {
+                (curr.op != OP_ASSIGN &&
+                curr.op != OP_ADD_ASSIGN &&
+                curr.op != OP_SUB_ASSIGN && 
+                curr.op != OP_MUL_ASSIGN &&
+                curr.op != OP_DIV_ASSIGN &&
+                curr.op != OP_MOD_ASSIGN)) {
                     syntaxError("Expected assignment operator");
                     return 0;
-            } char op[3];
-            strcpy(op, curr.lexeme);
+            } OperatorType op = curr.op;
             curr = nextToken();
             int value = expression();
             Symbol* sym = findSymbol(name);
             if (!sym) {
                 syntaxError("Variable not declared");
                 return 0;
+            } if (strcmp(sym->type, "int") != 0 && strcmp(sym->type, "float") != 0 &&
+                strcmp(sym->type, "char") != 0) {
+                syntaxError("Invalid assignment type");
+                return 0;
             } int current = 0;
             if (strcmp(sym->type, "int") == 0) current = sym->intVal;
             else if (strcmp(sym->type, "float") == 0) current = (int)sym->floatVal;
             else if (strcmp(sym->type, "char") == 0) current = (char)sym->charVal;
-            if (strcmp(op, "=") == 0) {
+            if (op == OP_ASSIGN) {
                 if (strcmp(sym->type, "int") == 0) sym->intVal = value;
                 else if (strcmp(sym->type, "float") == 0) sym->floatVal = (float)value;
                 else if (strcmp(sym->type, "char") == 0) sym->charVal = (char)value;
-            } else if (strcmp(op, "+=") == 0) {
+            } else if (op == OP_ADD_ASSIGN) {
                 if (strcmp(sym->type, "int") == 0) sym->intVal = current + value;
                 else if (strcmp(sym->type, "float") == 0) sym->floatVal = current + value;
                 else if (strcmp(sym->type, "char") == 0) sym->charVal = current + value;
-            } else if (strcmp(op, "-=") == 0) {
+            } else if (op == OP_SUB_ASSIGN) {
                 if (strcmp(sym->type, "int") == 0) sym->intVal = current - value;
                 else if (strcmp(sym->type, "float") == 0) sym->floatVal = current - value;
                 else if (strcmp(sym->type, "char") == 0) sym->charVal = current - value;
-            } else if (strcmp(op, "*=") == 0) {
+            } else if (op == OP_MUL_ASSIGN) {
                 if (strcmp(sym->type, "int") == 0) sym->intVal = current * value;
                 else if (strcmp(sym->type, "float") == 0) sym->floatVal = current * value;
                 else if (strcmp(sym->type, "char") == 0) sym->charVal = current * value;
-            } else if (strcmp(op, "/=") == 0) {
+            } else if (op == OP_DIV_ASSIGN) {
                 if (value == 0) {
                     syntaxError("Divide by zero");
                     return 0;
-                } if (strcmp(sym->type, "int") == 0) sym->intVal = current / value;
+                } if (strcmp(sym->type, "int") == 0) sym->intVal = value == -1 ? (int)(0u - (unsigned)current) : current / value;
                 else if (strcmp(sym->type, "float") == 0) sym->floatVal = current / value;
                 else if (strcmp(sym->type, "char") == 0) sym->charVal = current / value;
-            } else if (strcmp(op, "%=") == 0) {
-                sym->intVal = current % value;
-            } if (curr.type != TYPE_OPERATOR || strcmp(curr.lexeme, ";") != 0) {
+            } else if (op == OP_MOD_ASSIGN) {
+                if (strcmp(sym->type, "int") != 0) {
+                    syntaxError("Invalid assignment type");
+                    return 0;
+                } if (value == 0) {
+                    syntaxError("Divide by zero");
+                    return 0;
+                } sym->intVal = value == -1 ? 0 : current % value;
+            } if (!isOp(OP_SEMI)) {
                 syntaxError("Expected ';'");
                 return 0;
             } curr = nextToken();
@@ -173,9 +530,9 @@ int statement() {
         else if (strcmp(curr.lexeme, "while") == 0) return whileStat();
         else if (strcmp(curr.lexeme, "for") == 0) return forStat();
         else if (strcmp(curr.lexeme, "return") == 0) return returnStat();
-    } else if (curr.type == TYPE_OPERATOR && strcmp(curr.lexeme, "{") == 0) {
+    } else if (isOp(OP_LBRACE)) {
         return block();
-    } else if (curr.type == TYPE_OPERATOR && strcmp(curr.lexeme, ";") == 0) {
+    } else if (isOp(OP_SEMI)) {
         curr = nextToken();
         return 1;
     } else {
@@ -197,11 +554,12 @@ int statement() {
         return 0; 
     } strcpy(name, curr.lexeme);
     curr = nextToken();
-    if (curr.type == TYPE_OPERATOR && strcmp(curr.lexeme, "(") == 0) {
+    if (isOp(OP_LPAREN)) {
+        if (!isReachable(name)) return skipFunction();
         curr = nextToken(); 
         // parse parameters
         Symbol* params = NULL;
-        while (curr.type != TYPE_OPERATOR || strcmp(curr.lexeme, ")") != 0) {
+        while (!isOp(OP_RPAREN)) {
             if (curr.type == TYPE_TYPE) {
                 char paramType[20], paramName[256];
                 strcpy(paramType, curr.lexeme);
@@ -210,21 +568,23 @@ int statement() {
                     syntaxError("Expected parameter name");
                     return 0;
                 } strcpy(paramName, curr.lexeme);
-                Symbol* param = malloc(sizeof(Symbol));
+                Symbol* param = calloc(1, sizeof(Symbol)); // bodies run before any call binds a value
+                chargeAlloc(sizeof(Symbol));
                 strcpy(param->name, paramName);
                 strcpy(param->type, paramType);
                 param->next = params;
                 params = param;
                 curr = nextToken();
-                if (curr.type == TYPE_OPERATOR && strcmp(curr.lexeme, ",") == 0) 
+                if (isOp(OP_COMMA)) 
                     curr = nextToken();
             } else { break; }
-        } if (curr.type != TYPE_OPERATOR || strcmp(curr.lexeme, ")") != 0) {
+        } if (!isOp(OP_RPAREN)) {
             syntaxError("Expected ')'");
             return 0;
         } curr = nextToken();
         // add to function table
         Function* func = malloc(sizeof(Function));
+        chargeAlloc(sizeof(Function));
         strcpy(func->name, name);
         strcpy(func->returnType, type);
         func->params = params;
@@ -233,15 +593,19 @@ int statement() {
         funcTable = func;
         currentFunc = func;
         inFunc = 1;
+        if (profiling) profEnter(name);
+        budgetEnter();
         int result = block();
+        budgetLeave();
+        if (profiling) profLeave();
         inFunc = 0;
         currentFunc = NULL;
         return result;
     } // variable declaration
-    if (curr.type == TYPE_OPERATOR && strcmp(curr.lexeme, "=") == 0) {
+    if (isOp(OP_ASSIGN)) {
         curr = nextToken();
         value = expression();
-    } if (curr.type != TYPE_OPERATOR || strcmp(curr.lexeme, ";") != 0) {
+    } if (!isOp(OP_SEMI)) {
         syntaxError("Expected ';'");
         return 0;
     } curr = nextToken();
@@ -251,6 +615,7 @@ int statement() {
             syntaxError("No active func"); 
             return 0; 
         } Symbol* local = malloc(sizeof(Symbol));
+        chargeAlloc(sizeof(Symbol));
         strcpy(local->name, name);
         strcpy(local->type, type);
         if (strcmp(type, "int") == 0) local->intVal = value;
@@ -259,46 +624,118 @@ int statement() {
         local->next = currentFunc->locals;
         currentFunc->locals = local;
     } else { 
-        addSymbol(name, type, value); 
+        int last = -1;
+        for (int i = 0; i < numOverrides; i++) {
+            if (strcmp(overrides[i].name, name) == 0) last = i;
+        } if (last >= 0) {
+            value = overrides[last].value;
+            overrides[last].used = 1;
+        } addSymbol(name, type, value); 
     } return 1;
 }
 
 int expression() {
-    if (curr.type == TYPE_OPERATOR && strcmp(curr.lexeme, ";") == 0) return 0;
+    if (isOp(OP_SEMI)) return 0;
     return logicalOr();
 }
 
 void printTable() {
-    printf("\nGlobal Symbol Table:\n");
-    printf("\nType\tID\tValue\n");
-    printf("----\t--\t----\n");
+    if (outputFormat == FORMAT_JSON) {
+        sinkStr(out, ",\"globals\":[");
+        int first = 1;
+        for (Symbol* cur = table; cur != NULL; cur = cur->next) {
+            if (strcmp(cur->type, "int") != 0 && strcmp(cur->type, "float") != 0 &&
+                strcmp(cur->type, "char") != 0) continue;
+            sinkStr(out, first ? "{\"type\":" : ",{\"type\":");
+            first = 0;
+            sinkJsonStr(out, cur->type);
+            sinkStr(out, ",\"name\":");
+            sinkJsonStr(out, cur->name);
+            sinkStr(out, ",\"value\":");
+            if (strcmp(cur->type, "int") == 0) sinkInt(out, cur->intVal);
+            else if (strcmp(cur->type, "float") == 0) sinkFloat(out, cur->floatVal);
+            else {
+                char text[2] = { cur->charVal, '\0' };
+                sinkJsonStr(out, text);
+            } sinkChar(out, '}');
+        } sinkStr(out, "],\"functions\":[");
+        for (Function* func = funcTable; func != NULL; func = func->next) {
+            sinkStr(out, func == funcTable ? "{\"return\":" : ",{\"return\":");
+            sinkJsonStr(out, func->returnType);
+            sinkStr(out, ",\"name\":");
+            sinkJsonStr(out, func->name);
+            sinkStr(out, ",\"params\":[");
+            for (Symbol* param = func->params; param != NULL; param = param->next) {
+                sinkStr(out, param == func->params ? "{\"type\":" : ",{\"type\":");
+                sinkJsonStr(out, param->type);
+                sinkStr(out, ",\"name\":");
+                sinkJsonStr(out, param->name);
+                sinkChar(out, '}');
+            } sinkStr(out, "]}");
+        } sinkChar(out, ']');
+        return;
+    } if (outputFormat == FORMAT_BINARY) {
+        for (Symbol* cur = table; cur != NULL; cur = cur->next) {
+            if (strcmp(cur->type, "int") != 0 && strcmp(cur->type, "float") != 0 &&
+                strcmp(cur->type, "char") != 0) continue; // no value to encode, same as text/json
+            sinkU8(out, 'G');
+            sinkBinStr(out, cur->type);
+            sinkBinStr(out, cur->name);
+            if (strcmp(cur->type, "int") == 0) sinkI32(out, cur->intVal);
+            else if (strcmp(cur->type, "float") == 0) sinkF32(out, cur->floatVal);
+            else sinkU8(out, cur->charVal);
+        } for (Function* func = funcTable; func != NULL; func = func->next) {
+            int count = 0;
+            for (Symbol* param = func->params; param != NULL; param = param->next) count++;
+            sinkU8(out, 'F');
+            sinkBinStr(out, func->returnType);
+            sinkBinStr(out, func->name);
+            sinkU16(out, count);
+            for (Symbol* param = func->params; param != NULL; param = param->next) {
+                sinkBinStr(out, param->type);
+                sinkBinStr(out, param->name);
+            }
+        } return;
+    } sinkStr(out, "\nGlobal Symbol Table:\n");
+    sinkStr(out, "\nType\tID\tValue\n");
+    sinkStr(out, "----\t--\t----\n");
     Symbol* cur = table;
     while (cur != NULL) {
-        if (strcmp(cur->type, "int") == 0) {
-            printf("%s\t%s\t%d\n", cur->type, cur->name, cur->intVal);
-        } else if (strcmp(cur->type, "float") == 0) {
-            printf("%s\t%s\t%.2f\n", cur->type, cur->name, cur->floatVal);
-        } else if (strcmp(cur->type, "char") == 0) {
-            printf("%s\t%s\t%c\n", cur->type, cur->name, cur->charVal);
+        if (strcmp(cur->type, "int") == 0 || strcmp(cur->type, "float") == 0 ||
+            strcmp(cur->type, "char") == 0) {
+            sinkStr(out, cur->type);
+            sinkChar(out, '\t');
+            sinkStr(out, cur->name);
+            sinkChar(out, '\t');
+            if (strcmp(cur->type, "int") == 0) sinkInt(out, cur->intVal);
+            else if (strcmp(cur->type, "float") == 0) sinkFloat(out, cur->floatVal);
+            else sinkChar(out, cur->charVal);
+            sinkChar(out, '\n');
         } cur = cur->next;
-    } printf("\nFunction Table:\n");
-    printf("Return\tName\tParams\n");
-    printf("------\t----\t------\n");
+    } sinkStr(out, "\nFunction Table:\n");
+    sinkStr(out, "Return\tName\tParams\n");
+    sinkStr(out, "------\t----\t------\n");
     Function* func = funcTable;
     while (func != NULL) {
-        printf("%s\t%s\t", func->returnType, func->name);
+        sinkStr(out, func->returnType);
+        sinkChar(out, '\t');
+        sinkStr(out, func->name);
+        sinkChar(out, '\t');
         Symbol* param = func->params;
         while (param != NULL) {
-            printf("%s %s", param->type, param->name);
+            sinkStr(out, param->type);
+            sinkChar(out, ' ');
+            sinkStr(out, param->name);
             param = param->next;
-            if (param != NULL) printf(", ");
-        } printf("\n");
+            if (param != NULL) sinkStr(out, ", ");
+        } sinkChar(out, '\n');
         func = func->next;
     }
 }
 
 void addSymbol(char* name, char* type, int val) {
     Symbol* sym = malloc(sizeof(Symbol));
+    chargeAlloc(sizeof(Symbol));
     strcpy(sym->name, name);
     strcpy(sym->type, type);
     if (strcmp(type, "int") == 0) {
@@ -312,37 +749,68 @@ void addSymbol(char* name, char* type, int val) {
 }
 
 void syntaxError(char* msg) {
-    printf("Error at line %d:%s\n", curr.line, msg);
+    diagnostic(msg, curr.line);
+}
+
+// line 0 = not tied to a source line (command-line and --runs input)
+void diagnostic(char* msg, int line) {
+    if (outputFormat == FORMAT_JSON) {
+        sinkStr(out, "{\"error\":");
+        sinkJsonStr(out, msg);
+        sinkStr(out, ",\"line\":");
+        sinkInt(out, line);
+        sinkStr(out, "}\n");
+    } else if (outputFormat == FORMAT_BINARY) {
+        sinkU8(out, 'E');
+        sinkI32(out, line);
+        sinkBinStr(out, msg);
+    } else {
+        if (line > 0) {
+            sinkStr(out, "Error at line ");
+            sinkInt(out, line);
+        } else sinkStr(out, "Error");
+        sinkChar(out, ':');
+        sinkStr(out, msg);
+        sinkChar(out, '\n');
+    }
 }
 
 Symbol* findSymbol(char* name) {
+    STAT_INC(symbolLookups);
     if (inFunc && currentFunc != NULL) {
         Symbol* local = currentFunc->locals;
         while(local != NULL) {
+            STAT_INC(symbolSteps);
             if (strcmp(local->name, name) == 0) return local;
             local = local->next; 
         } // check func parameters
         Symbol* param = currentFunc->params;
         while (param != NULL) {
+            STAT_INC(symbolSteps);
             if (strcmp(param->name, name) == 0) return param;
             param = param->next;
         }
     } // global variables
     Symbol* cur = table;
     while (cur != NULL) {
+        STAT_INC(symbolSteps);
         if (strcmp(cur->name, name) == 0) return cur;
         cur = cur->next;
     } return NULL;
 }
 
+int isOp(OperatorType op) {
+    return curr.type == TYPE_OPERATOR && curr.op == op;
+}
+
 // expression parsing
 int logicalOr() {
     int l = logicalAnd();   
-    while (curr.type == TYPE_OPERATOR && strcmp(curr.lexeme, "||") == 0) {
+    while (isOp(OP_OR)) {
         curr = nextToken();
         int r = logicalAnd();
         l = l || r;
-        if (curr.type == TYPE_OPERATOR && strcmp(curr.lexeme, ";") == 0) {
+        if (isOp(OP_SEMI)) {
             break;
         }
     } return l;
@@ -350,7 +818,7 @@ int logicalOr() {
 
 int logicalAnd() {
     int l = equality();
-    while (curr.type == TYPE_OPERATOR && strcmp(curr.lexeme, "&&") == 0) {
+    while (isOp(OP_AND)) {
         curr = nextToken();
         int r = equality();
         l = l && r;
@@ -359,11 +827,11 @@ int logicalAnd() {
 
 int equality() {
     int l = comparison();
-    while (curr.type == TYPE_OPERATOR && (strcmp(curr.lexeme, "==") == 0 || strcmp(curr.lexeme, "!=") == 0)) {
-        char* op = curr.lexeme;
+    while (curr.type == TYPE_OPERATOR && (curr.op == OP_EQ || curr.op == OP_NE)) {
+        OperatorType op = curr.op;
         curr = nextToken();
         int r = comparison();
-        if (strcmp(op, "==") == 0) {  l = l == r ? 1 : 0; } 
+        if (op == OP_EQ) {  l = l == r ? 1 : 0; } 
         else  { l = l != r ? 1 : 0; } 
     } return l;
 }
@@ -371,26 +839,25 @@ int equality() {
 int comparison() {
     int l = additive();
     while (curr.type == TYPE_OPERATOR && 
-        (strcmp(curr.lexeme, "<") == 0 || strcmp(curr.lexeme, ">") == 0 || 
-        strcmp(curr.lexeme, "<=") == 0 || strcmp(curr.lexeme, ">=") == 0))  {
-        char*op = curr.lexeme;
+        (curr.op == OP_LT || curr.op == OP_GT || 
+        curr.op == OP_LE || curr.op == OP_GE))  {
+        OperatorType op = curr.op;
         curr = nextToken();
         int r = additive();
-        if (strcmp(op, "<") == 0) { l = (l < r) ? 1 : 0; }
-        else if (strcmp(op, ">") == 0) { l = (l > r) ? 1 : 0; }
-        else if (strcmp(op, "<=") == 0) { l = (l <= r) ? 1 : 0; }
+        if (op == OP_LT) { l = (l < r) ? 1 : 0; }
+        else if (op == OP_GT) { l = (l > r) ? 1 : 0; }
+        else if (op == OP_LE) { l = (l <= r) ? 1 : 0; }
         else { l = (l >= r) ? 1 : 0; }
     } return l;
 }
 
 int additive() {
     int l = multiplicative();
-    while (curr.type == TYPE_OPERATOR && (strcmp(curr.lexeme, "+") == 0 || strcmp(curr.lexeme, "-") == 0)) {
-        char op[3];
-        strcpy(op, curr.lexeme);
+    while (curr.type == TYPE_OPERATOR && (curr.op == OP_PLUS || curr.op == OP_MINUS)) {
+        OperatorType op = curr.op;
         curr = nextToken();
         int r = multiplicative();
-        if (strcmp(op, "+") == 0) { l = l + r; } 
+        if (op == OP_PLUS) { l = l + r; } 
         else { l = l - r; } 
     } return l;
 }
@@ -398,33 +865,34 @@ int additive() {
 int multiplicative() {
     int l = unary();
     while (curr.type == TYPE_OPERATOR && 
-      (strcmp(curr.lexeme, "*") == 0 || strcmp(curr.lexeme, "/") == 0 || 
-       strcmp(curr.lexeme, "%") == 0)) {
-        char op[3];
-        strcpy(op, curr.lexeme);
+      (curr.op == OP_STAR || curr.op == OP_SLASH || 
+       curr.op == OP_PERCENT)) {
+        OperatorType op = curr.op;
         curr = nextToken();
         int r = unary();
-        if (strcmp(op, "*") == 0) { l = l * r; } 
-        else if (strcmp(op, "/") == 0) {
+        if (op == OP_STAR) { l = l * r; } 
+        else {
             if (r == 0) {
                 syntaxError("Division by zero");
+                exprFailed = 1;
                 return 0;
-            } l = l / r;
-        } else { l = l % r; }      
+            } if (r == -1) l = op == OP_SLASH ? (int)(0u - (unsigned)l) : 0; // INT_MIN / -1 traps too
+            else l = op == OP_SLASH ? l / r : l % r;
+        }
     } return l; 
 } 
 
 int unary() {
-    if (curr.type == TYPE_OPERATOR && strcmp(curr.lexeme, "!") == 0) {
+    if (isOp(OP_NOT)) {
         curr = nextToken();
         return !unary();
-    } else if (curr.type == TYPE_OPERATOR && strcmp(curr.lexeme, "-") == 0) {
+    } else if (isOp(OP_MINUS)) {
         curr = nextToken();
         return -unary();
-    } else if (curr.type == TYPE_OPERATOR && strcmp(curr.lexeme, "++") == 0) {
+    } else if (isOp(OP_INC)) {
         curr = nextToken();
         return unary();
-    } else if (curr.type == TYPE_OPERATOR && strcmp(curr.lexeme, "--") == 0) {
+    } else if (isOp(OP_DEC)) {
         curr = nextToken();
         return unary();
     } return primary();
@@ -445,55 +913,43 @@ int primary() {
         char identName[256];
         strcpy(identName, curr.lexeme);
         curr = nextToken();
-        if (curr.type == TYPE_OPERATOR && strcmp(curr.lexeme, "(") == 0) {
-            Function* func = funcTable;
-            while (func != NULL && strcmp(func->name, identName) != 0) func = func->next;
-            if (func == NULL) {
-                syntaxError("Undefined function");
-                return 0;
-            } curr = nextToken();
-            Symbol* param = func->params;
-            while (curr.type != TYPE_OPERATOR || strcmp(curr.lexeme, ")") != 0) {
-                int argValue = expression();
-                if (param != NULL) {
-                    if (strcmp(param->type, "int") == 0) param->intVal = argValue;
-                    else if (strcmp(param->type, "float") == 0) param->floatVal = (float)argValue;
-                    else if (strcmp(param->type, "char") == 0) param->charVal = (char)argValue;
-                    param = param->next;
-                } if (curr.type == TYPE_OPERATOR && strcmp(curr.lexeme, ",") == 0) curr = nextToken();
-            } if (curr.type != TYPE_OPERATOR || strcmp(curr.lexeme, ")") != 0) {
-                syntaxError("Expected ')' in function call");
+        if (isOp(OP_LPAREN)) {
+            if (!funcCall(identName)) {
+                exprFailed = 1;
                 return 0;
-            } curr = nextToken();
-            value = returnValue;
+            } value = returnValue;
         } else {
             Symbol* sym = findSymbol(identName);
-            if (sym == NULL) value = 0;
-            else {
+            if (sym == NULL) {
+                syntaxError("Variable not declared");
+                exprFailed = 1;
+                value = 0;
+            } else {
                 if (strcmp(sym->type, "int") == 0) value = sym->intVal;           
                 else if (strcmp(sym->type, "float") == 0) value = (int)sym->floatVal;
                 else if (strcmp(sym->type, "char") == 0) value = sym->charVal; 
             }
         }
-    } else if (curr.type == TYPE_OPERATOR && strcmp(curr.lexeme, "(") == 0) {
+    } else if (isOp(OP_LPAREN)) {
         curr = nextToken();
-        if (curr.type == TYPE_EOF) { syntaxError("Unexpected EOF after '('"); return 0; }
+        if (curr.type == TYPE_EOF) { syntaxError("Unexpected EOF after '('"); exprFailed = 1; return 0; }
         value = expression();
-        if (curr.type != TYPE_OPERATOR || strcmp(curr.lexeme, ")") != 0) {
+        if (!isOp(OP_RPAREN)) {
             syntaxError("Expected ')'");
+            exprFailed = 1;
             return 0;
         }  curr = nextToken();
     } else {
         return 0;
-    } if (curr.type == TYPE_OPERATOR && (strcmp(curr.lexeme, "++") == 0 || strcmp(curr.lexeme, "--") == 0)) {
+    } if (curr.type == TYPE_OPERATOR && (curr.op == OP_INC || curr.op == OP_DEC)) {
         curr = nextToken();
     } return value;
 }
 
 int block() {
-    if (curr.type != TYPE_OPERATOR || strcmp(curr.lexeme, "{") != 0) return 0;
+    if (!isOp(OP_LBRACE)) return 0;
     curr = nextToken();
-    while (curr.type != TYPE_OPERATOR || strcmp(curr.lexeme, "}") != 0) {
+    while (!isOp(OP_RBRACE)) {
         if (curr.type == TYPE_EOF) { syntaxError("Unexpected EOF in block"); return 0; }
         if (!statement()) return 0;
     } curr = nextToken();
@@ -503,12 +959,12 @@ int block() {
 int ifStat() {
     if (curr.type != TYPE_RESERVED || strcmp(curr.lexeme, "if") != 0) return 0;
     curr = nextToken();
-    if (curr.type != TYPE_OPERATOR || strcmp(curr.lexeme, "(") != 0) {
+    if (!isOp(OP_LPAREN)) {
         syntaxError("Expected '(' after if");
         return 0;
     } curr = nextToken();
     int cond = expression(); 
-    if (curr.type != TYPE_OPERATOR || strcmp(curr.lexeme, ")") != 0) {
+    if (!isOp(OP_RPAREN)) {
         syntaxError("Expected ')' after if condition");
         return 0;
     } curr = nextToken();
@@ -523,22 +979,23 @@ int ifStat() {
 int whileStat() {
     if (curr.type != TYPE_RESERVED || strcmp(curr.lexeme, "while") != 0) return 0;
     curr = nextToken();
-    if (curr.type != TYPE_OPERATOR || strcmp(curr.lexeme, "(") != 0) {
+    if (!isOp(OP_LPAREN)) {
         syntaxError("Expected '(' after while");
         return 0;
     } curr = nextToken();
     int cond = expression(); 
-    if (curr.type != TYPE_OPERATOR || strcmp(curr.lexeme, ")") != 0) {
+    if (!isOp(OP_RPAREN)) {
         syntaxError("Expected ')' after while condition");
         return 0;
     } curr = nextToken();
+    budgetCheck(); // loop back-edge
     return statement();
 }
 
 int forStat() {
     if (curr.type != TYPE_RESERVED || strcmp(curr.lexeme, "for") != 0) return 0;
     curr = nextToken();
-    if (curr.type != TYPE_OPERATOR || strcmp(curr.lexeme, "(") != 0) {
+    if (!isOp(OP_LPAREN)) {
         syntaxError("Expected '(' after for");
         return 0;
     } curr = nextToken();
@@ -546,33 +1003,34 @@ int forStat() {
         if (!statement()) return 0;
     } else if (curr.type == TYPE_IDENTIFIER) {
         expression();
-        if (curr.type != TYPE_OPERATOR || strcmp(curr.lexeme, ";") != 0) {
+        if (!isOp(OP_SEMI)) {
             syntaxError("Expected ';' after initialization");
             return 0;
         } curr = nextToken();
-    } else if (curr.type == TYPE_OPERATOR && strcmp(curr.lexeme, ";") == 0) {
+    } else if (isOp(OP_SEMI)) {
         curr = nextToken();
     } else {
         syntaxError("Invalid for loop initialization");
         return 0;
-    } if (!(curr.type == TYPE_OPERATOR && strcmp(curr.lexeme, ";") == 0)) expression();
-    if (curr.type != TYPE_OPERATOR || strcmp(curr.lexeme, ";") != 0) {
+    } if (!(isOp(OP_SEMI))) expression();
+    if (!isOp(OP_SEMI)) {
         syntaxError("Expected ';' after for condition");
         return 0;
     } curr = nextToken();
-    if (!(curr.type == TYPE_OPERATOR && strcmp(curr.lexeme, ")") == 0)) expression();
-    if (curr.type != TYPE_OPERATOR || strcmp(curr.lexeme, ")") != 0) {
+    if (!(isOp(OP_RPAREN))) expression();
+    if (!isOp(OP_RPAREN)) {
         syntaxError("Expected ')' in for loop");
         return 0;
     } curr = nextToken();
+    budgetCheck(); // loop back-edge
     return statement();
 }
 
 int returnStat() {
     if (curr.type != TYPE_RESERVED || strcmp(curr.lexeme, "return") != 0) return 0;
     curr = nextToken();
-    if (curr.type != TYPE_OPERATOR || strcmp(curr.lexeme, ";") != 0) returnValue = expression();
-    if (curr.type != TYPE_OPERATOR || strcmp(curr.lexeme, ";") != 0) {
+    if (!isOp(OP_SEMI)) returnValue = expression();
+    if (!isOp(OP_SEMI)) {
         syntaxError("Expected ';' after return");
         return 0;
     } curr = nextToken();
@@ -580,27 +1038,46 @@ int returnStat() {
 }
 
 int funcCall(char* name) {
-    Function* func = funcTable;
-    while (func != NULL && strcmp(func->name, name) != 0) func = func->next;
+    Function* func = findFunc(name);
     if (func == NULL) {
         syntaxError("Undefined function");
         return 0;
-    } curr = nextToken();
-    if (curr.type != TYPE_OPERATOR || strcmp(curr.lexeme, "(") != 0) return 0;
+    } if (profiling) profCall(name);
+    budgetEnter();
     curr = nextToken();
-    int count = 0;
-    while (curr.type != TYPE_OPERATOR || strcmp(curr.lexeme, ")") != 0) {
-        expression();
+    // bind args to params, counting both sides
+    Symbol* param = func->params;
+    int count = 0, expected = 0;
+    for (Symbol* p = func->params; p != NULL; p = p->next) expected++;
+    while (!isOp(OP_RPAREN)) {
+        if (curr.type == TYPE_EOF) {
+            syntaxError("Expected ')' in function call");
+            budgetLeave();
+            return 0;
+        } int argValue = expression();
         count++;
-        if (curr.type == TYPE_OPERATOR && strcmp(curr.lexeme, ",") == 0) curr = nextToken();
-    } if (curr.type != TYPE_OPERATOR || strcmp(curr.lexeme, ")") != 0) return 0;
-    curr = nextToken();
-    returnValue = 0;
-    return 1;
+        if (param != NULL) {
+            if (strcmp(param->type, "int") == 0) param->intVal = argValue;
+            else if (strcmp(param->type, "float") == 0) param->floatVal = (float)argValue;
+            else if (strcmp(param->type, "char") == 0) param->charVal = (char)argValue;
+            param = param->next;
+        } if (isOp(OP_COMMA)) curr = nextToken();
+        else if (!isOp(OP_RPAREN)) {
+            syntaxError("Expected ')' in function call");
+            budgetLeave();
+            return 0;
+        }
+    } curr = nextToken();
+    budgetLeave();
+    if (count != expected) {
+        syntaxError("Argument count mismatch");
+        return 0;
+    } return 1;
 }
 
 void addFunc(char*name, char* returnType) {
     Function* func = malloc(sizeof(Function));
+    chargeAlloc(sizeof(Function));
     strcpy(func->name, name);
     strcpy(func->returnType, returnType);
     func->params = NULL;
@@ -610,9 +1087,178 @@ void addFunc(char*name, char* returnType) {
 }
 
 Function* findFunc(char* name) {
+    STAT_INC(funcLookups);
     Function* func = funcTable;
     while (func != NULL) {
+        STAT_INC(funcSteps);
         if (strcmp(func->name, name) == 0) return func;
         func = func->next;
     } return NULL;
+}
+
+// call graph: scan the buffered tokens for definitions and call sites
+void buildCallGraph() {
+    CallNode* top = calloc(1, sizeof(CallNode)); // top-level statements, unnamed
+    chargeAlloc(sizeof(CallNode));
+    callGraph = top;
+    callIndexSize = 64;
+    while (callIndexSize < (unsigned)tokenCount() / 2) callIndexSize *= 2;
+    callIndex = calloc(callIndexSize, sizeof(CallNode*));
+    chargeAlloc(callIndexSize * sizeof(CallNode*));
+    CallNode* tail = top;
+    CallNode* owner = top;
+    int depth = 0;
+    for (int i = 0; i < tokenCount(); i++) {
+        Token* tok = tokenAt(i);
+        if (tok->type == TYPE_OPERATOR && tok->op == OP_LBRACE) depth++;
+        else if (tok->type == TYPE_OPERATOR && tok->op == OP_RBRACE) {
+            if (depth > 0 && --depth == 0) owner = top;
+        } else if (tok->type == TYPE_OPERATOR && tok->op == OP_SEMI) {
+            if (depth == 0) owner = top;
+        } else if (depth == 0 && tok->type == TYPE_TYPE && tokenAt(i + 1)->type == TYPE_IDENTIFIER &&
+            tokenAt(i + 2)->type == TYPE_OPERATOR && tokenAt(i + 2)->op == OP_LPAREN) {
+            owner = findCallNode(tokenAt(i + 1)->lexeme);
+            if (owner == NULL) {
+                owner = calloc(1, sizeof(CallNode));
+                chargeAlloc(sizeof(CallNode));
+                strcpy(owner->name, tokenAt(i + 1)->lexeme);
+                tail->next = owner;
+                tail = owner;
+                unsigned h = hashName(owner->name) & (callIndexSize - 1);
+                owner->bucketNext = callIndex[h];
+                callIndex[h] = owner;
+            } i += 2;
+        } else if (tok->type == TYPE_IDENTIFIER && tokenAt(i + 1)->type == TYPE_OPERATOR &&
+            tokenAt(i + 1)->op == OP_LPAREN) {
+            CallSite* site = malloc(sizeof(CallSite));
+            chargeAlloc(sizeof(CallSite));
+            strcpy(site->name, tok->lexeme);
+            site->next = owner->calls;
+            owner->calls = site;
+        }
+    } for (CallNode* node = callGraph; node != NULL; node = node->next) {
+        for (CallSite* site = node->calls; site != NULL; site = site->next) site->target = findCallNode(site->name);
+    } // roots: top-level statements and main; without main every function is kept
+    CallNode* entry = findCallNode("main");
+    if (entry == NULL) {
+        for (CallNode* node = callGraph; node != NULL; node = node->next) node->reachable = 1;
+        return;
+    } markReachable(top);
+    markReachable(entry);
+}
+
+unsigned hashName(char* name) {
+    unsigned h = 5381;
+    while (*name) h = h * 33 + (unsigned char)*name++;
+    return h;
+}
+
+CallNode* findCallNode(char* name) {
+    if (callIndex == NULL) return NULL;
+    CallNode* node = callIndex[hashName(name) & (callIndexSize - 1)];
+    while (node != NULL) {
+        if (strcmp(node->name, name) == 0) return node;
+        node = node->bucketNext;
+    } return NULL;
+}
+
+// worklist walk, call chains can be far deeper than the C stack
+void markReachable(CallNode* node) {
+    if (node == NULL || node->reachable) return;
+    node->reachable = 1;
+    CallNode* work = node;
+    node->pending = NULL;
+    while (work != NULL) {
+        CallNode* cur = work;
+        work = cur->pending;
+        for (CallSite* site = cur->calls; site != NULL; site = site->next) {
+            CallNode* target = site->target;
+            if (target == NULL || target->reachable) continue;
+            target->reachable = 1;
+            target->pending = work;
+            work = target;
+        }
+    }
+}
+
+int isReachable(char* name) {
+    if (keepUnused) return 1;
+    CallNode* node = findCallNode(name);
+    return node == NULL || node->reachable;
+}
+
+// consume an unreachable definition from '(' through its closing '}'
+int skipFunction() {
+    while (!isOp(OP_RPAREN)) {
+        if (curr.type == TYPE_EOF) {
+            syntaxError("Expected ')'");
+            return 0;
+        } curr = nextToken();
+    } curr = nextToken();
+    if (!isOp(OP_LBRACE)) return 0;
+    int depth = 0;
+    do {
+        if (curr.type == TYPE_EOF) {
+            syntaxError("Unexpected EOF in block");
+            return 0;
+        } if (isOp(OP_LBRACE)) depth++;
+        else if (isOp(OP_RBRACE)) depth--;
+        curr = nextToken();
+    } while (depth > 0);
+    return 1;
+}
+
+void printUnused() {
+    if (outputFormat == FORMAT_JSON) sinkStr(out, ",\"unused\":[");
+    else if (outputFormat == FORMAT_TEXT) sinkStr(out, "\nUnused Functions:\nName\n----\n");
+    int first = 1;
+    for (CallNode* node = callGraph; node != NULL; node = node->next) {
+        if (node->name[0] == '\0' || node->reachable) continue;
+        if (outputFormat == FORMAT_JSON) {
+            if (!first) sinkChar(out, ',');
+            sinkJsonStr(out, node->name);
+        } else if (outputFormat == FORMAT_BINARY) {
+            sinkU8(out, 'U');
+            sinkBinStr(out, node->name);
+        } else {
+            sinkStr(out, node->name);
+            sinkChar(out, '\n');
+        } first = 0;
+    } if (outputFormat == FORMAT_JSON) sinkChar(out, ']');
+}
+
+// drop all tables before a re-parse
+void freeTables() {
+    while (table != NULL) {
+        Symbol* next = table->next;
+        free(table);
+        table = next;
+    } while (funcTable != NULL) {
+        Function* next = funcTable->next;
+        Symbol* lists[2] = { funcTable->params, funcTable->locals };
+        for (int i = 0; i < 2; i++) {
+            while (lists[i] != NULL) {
+                Symbol* sym = lists[i]->next;
+                free(lists[i]);
+                lists[i] = sym;
+            }
+        } free(funcTable);
+        funcTable = next;
+    } currentFunc = NULL;
+    inFunc = 0;
+    returnValue = 0;
+}
+
+void freeCallGraph() {
+    while (callGraph != NULL) {
+        CallNode* next = callGraph->next;
+        while (callGraph->calls != NULL) {
+            CallSite* site = callGraph->calls->next;
+            free(callGraph->calls);
+            callGraph->calls = site;
+        } free(callGraph);
+        callGraph = next;
+    } free(callIndex);
+    callIndex = NULL;
+    callIndexSize = 0;
 }
\ No newline at end of file
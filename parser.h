@@ -0,0 +1,31 @@
+#ifndef PARSER_H
+#define PARSER_H
+
+#include <stddef.h>
+
+// initial value for a global, applied when its declaration runs
+typedef struct {
+    char name[256];
+    int value;
+    int used; // set when a global declaration took the value
+} Override;
+
+// one execution of the shared program, with its own globals and output
+typedef struct {
+    Override* overrides;
+    int numOverrides;
+    char* output; // captured report, malloc'd
+    size_t outputLen;
+    int status; // 1 ok, 0 syntax error, -1 budget exceeded
+} Run;
+
+// func dec
+int parseOverride(char* text, Override* override);
+int runProgram(Run* run);
+void runAll(Run* runs, int numRuns, int numThreads);
+// shared with check.c
+unsigned hashName(char* name);
+int isReachable(char* name);
+void diagnostic(char* msg, int line);
+
+#endif
@@ -0,0 +1,161 @@
+// profile.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <sys/time.h>
+#include "profile.h"
+#include "stats.h"
+
+#define MAX_DEPTH 16
+#define MAX_SAMPLES 65536
+
+// per-function totals
+typedef struct {
+    char name[256];
+    long calls;
+    double selfMs;
+    double totalMs;
+} ProfFunc;
+
+// one interpreted activation
+typedef struct {
+    int id;
+    double start;
+    double childMs;
+} ProfFrame;
+
+typedef struct {
+    int depth;
+    int ids[MAX_DEPTH];
+} Sample;
+
+int profiling = 0;
+ProfFunc* profFuncs = NULL;
+int numProfFuncs = 0;
+ProfFrame profStack[MAX_DEPTH];
+volatile sig_atomic_t profDepth = 0; // read by the SIGPROF handler
+int profOverflow = 0; // frames deeper than MAX_DEPTH
+Sample* samples = NULL;
+volatile sig_atomic_t numSamples = 0;
+char* profFile = NULL;
+int sampleEvery = 0; // statements per sample, 0 = timer
+int sampleCountdown = 0;
+
+int profFuncId(char* name) {
+    for (int i = 0; i < numProfFuncs; i++) {
+        if (strcmp(profFuncs[i].name, name) == 0) return i;
+    } profFuncs = realloc(profFuncs, (numProfFuncs + 1) * sizeof(ProfFunc));
+    ProfFunc* func = &profFuncs[numProfFuncs];
+    memset(func, 0, sizeof(ProfFunc));
+    strcpy(func->name, name);
+    return numProfFuncs++;
+}
+
+// snapshot the interpreted stack, safe to call from the signal handler
+void recordSample() {
+    if (numSamples >= MAX_SAMPLES) return;
+    Sample* sample = &samples[numSamples];
+    int depth = profDepth;
+    for (int i = 0; i < depth; i++) sample->ids[i] = profStack[i].id;
+    sample->depth = depth;
+    atomic_signal_fence(memory_order_release); // sample is complete before it is counted
+    numSamples++;
+}
+
+void onProfSignal(int sig) {
+    (void)sig;
+    recordSample();
+}
+
+void profStart(char* outFile, int everyStatements) {
+    samples = malloc(MAX_SAMPLES * sizeof(Sample));
+    profFile = outFile;
+    sampleEvery = sampleCountdown = everyStatements;
+    profiling = 1;
+    profEnter("<top>");
+    if (sampleEvery == 0) {
+        signal(SIGPROF, onProfSignal);
+        struct itimerval timer = { { 0, 1000 }, { 0, 1000 } }; // 1ms of cpu time
+        setitimer(ITIMER_PROF, &timer, NULL);
+    }
+}
+
+void profStop() {
+    if (!profiling) return;
+    if (sampleEvery == 0) {
+        struct itimerval off = { { 0, 0 }, { 0, 0 } };
+        setitimer(ITIMER_PROF, &off, NULL);
+        signal(SIGPROF, SIG_DFL);
+    } while (profDepth > 0) profLeave();
+    profiling = 0;
+    FILE* out = fopen(profFile, "w");
+    if (!out) {
+        printf("Cannot write profile to %s\n", profFile);
+        return;
+    } // collapsed stacks: "a;b;c count" per distinct stack
+    int* counted = calloc(numSamples, sizeof(int));
+    for (int i = 0; i < numSamples; i++) {
+        if (counted[i]) continue;
+        long count = 0;
+        for (int j = i; j < numSamples; j++) {
+            if (counted[j] || samples[j].depth != samples[i].depth ||
+                memcmp(samples[j].ids, samples[i].ids, samples[i].depth * sizeof(int)) != 0) continue;
+            counted[j] = 1;
+            count++;
+        } for (int d = 0; d < samples[i].depth; d++) {
+            fprintf(out, "%s%s", d ? ";" : "", profFuncs[samples[i].ids[d]].name);
+        } fprintf(out, " %ld\n", count);
+    } free(counted);
+    fclose(out);
+}
+
+void profEnter(char* name) {
+    if (!profiling) return;
+    if (profDepth == MAX_DEPTH) {
+        profOverflow++;
+        return;
+    } ProfFrame* frame = &profStack[profDepth];
+    frame->id = profFuncId(name);
+    frame->start = nowMs();
+    frame->childMs = 0;
+    atomic_signal_fence(memory_order_release); // frame is filled before the handler can see it
+    profDepth++;
+}
+
+void profLeave() {
+    if (!profiling) return;
+    if (profOverflow > 0) {
+        profOverflow--;
+        return;
+    } ProfFrame* frame = &profStack[profDepth - 1];
+    double total = nowMs() - frame->start;
+    profFuncs[frame->id].totalMs += total;
+    profFuncs[frame->id].selfMs += total - frame->childMs;
+    profDepth--;
+    if (profDepth > 0) profStack[profDepth - 1].childMs += total;
+}
+
+void profCall(char* name) {
+    if (!profiling) return;
+    profFuncs[profFuncId(name)].calls++;
+}
+
+void profTick() {
+    if (!profiling || sampleEvery == 0) return;
+    if (--sampleCountdown == 0) {
+        sampleCountdown = sampleEvery;
+        recordSample();
+    }
+}
+
+void printProfile() {
+    printf("\nProfile (%d samples):\n", numSamples);
+    printf("Name\tCalls\tSelf ms\tTotal ms\n");
+    printf("----\t-----\t-------\t--------\n");
+    for (int i = 0; i < numProfFuncs; i++) {
+        printf("%s\t%ld\t%.3f\t%.3f\n", profFuncs[i].name, profFuncs[i].calls,
+            profFuncs[i].selfMs, profFuncs[i].totalMs);
+    }
+}
@@ -0,0 +1,16 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+// guest-program profiler, every hook is a no-op unless profiling is set
+extern int profiling;
+
+// func dec
+void profStart(char* outFile, int everyStatements);
+void profStop();
+void profEnter(char* name);
+void profLeave();
+void profCall(char* name);
+void profTick();
+void printProfile();
+
+#endif
@@ -0,0 +1,54 @@
+// stats.c
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "stats.h"
+
+_Thread_local Stats stats;
+
+double nowMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+void resetStats() {
+    memset(&stats, 0, sizeof(stats));
+}
+
+long peakRssKb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+void printStats(int json) {
+    if (json) {
+        printf("{\"chars\":%ld,\"tokens\":%ld,\"statements\":%ld,"
+            "\"symbol_lookups\":%ld,\"symbol_steps\":%ld,"
+            "\"func_lookups\":%ld,\"func_steps\":%ld,"
+            "\"allocs\":%ld,\"alloc_bytes\":%ld,"
+            "\"lex_ms\":%.3f,\"callgraph_ms\":%.3f,\"check_ms\":%.3f,\"parse_ms\":%.3f,"
+            "\"peak_rss_kb\":%ld}\n",
+            stats.chars, stats.tokens, stats.statements,
+            stats.symbolLookups, stats.symbolSteps,
+            stats.funcLookups, stats.funcSteps,
+            stats.allocs, stats.allocBytes,
+            stats.lexMs, stats.graphMs, stats.checkMs, stats.parseMs, peakRssKb());
+        return;
+    } printf("\nStats:\n");
+    printf("chars read\t%ld\n", stats.chars);
+    printf("tokens\t\t%ld\n", stats.tokens);
+    printf("statements\t%ld\n", stats.statements);
+    printf("symbol lookups\t%ld (%.2f steps avg)\n", stats.symbolLookups,
+        stats.symbolLookups ? (double)stats.symbolSteps / stats.symbolLookups : 0.0);
+    printf("func lookups\t%ld (%.2f steps avg)\n", stats.funcLookups,
+        stats.funcLookups ? (double)stats.funcSteps / stats.funcLookups : 0.0);
+    printf("allocations\t%ld (%ld bytes)\n", stats.allocs, stats.allocBytes);
+    printf("lex\t\t%.3f ms\n", stats.lexMs);
+    printf("call graph\t%.3f ms\n", stats.graphMs);
+    printf("check\t\t%.3f ms\n", stats.checkMs);
+    printf("parse/execute\t%.3f ms\n", stats.parseMs);
+    printf("peak rss\t%ld KB\n", peakRssKb());
+}
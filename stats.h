@@ -0,0 +1,39 @@
+#ifndef STATS_H
+#define STATS_H
+
+// hot-path counters, compiled out with -DNO_STATS
+typedef struct {
+    long chars;         // nextChar() calls
+    long tokens;        // tokens handed out by nextToken()
+    long statements;
+    long symbolLookups;
+    long symbolSteps;   // chain nodes walked by findSymbol()
+    long funcLookups;
+    long funcSteps;     // chain nodes walked by findFunc()
+    long allocs;
+    long allocBytes;
+    double lexMs;
+    double graphMs;
+    double checkMs;     // static checks before execution
+    double parseMs;     // parse and execution are one pass
+} Stats;
+
+extern _Thread_local Stats stats;
+
+#ifdef NO_STATS
+#define STAT_INC(field) ((void)0)
+#define STAT_ADD(field, n) ((void)sizeof(n)) // keeps timing locals used, n is not evaluated
+#define STAT_ALLOC(size) ((void)0)
+#else
+#define STAT_INC(field) (stats.field++)
+#define STAT_ADD(field, n) (stats.field += (n))
+#define STAT_ALLOC(size) (stats.allocs++, stats.allocBytes += (long)(size))
+#endif
+
+// func dec
+double nowMs();
+void resetStats();
+long peakRssKb();
+void printStats(int json);
+
+#endif